@@ -0,0 +1,742 @@
+// the tracing code shared by the fragment (ray_tracer.frag) and the compute (ray_tracer.comp) ray tracer, it is included after the #version line
+
+layout(std430, binding = 0) buffer VerteciesBuffer {
+    readonly vec4 vertecies[];
+};
+
+layout(std430, binding = 1) buffer NormalsBuffer {
+    readonly vec4 normals[];
+};
+
+layout(std430, binding = 2) buffer IndeciesBuffer {
+    readonly uvec4 indecies[];
+};
+
+layout(std430, binding = 3) buffer NodesBuffer {
+    readonly uint nodes[];
+};
+
+// the analytic objects and the materials are uploaded from ScenePrimitives.hpp (the same layout), 4-7 are used by the wavefront queues
+
+struct AnalyticPrimitive {
+    vec3 position; // the center of a sphere, one end of a cylinder
+    float radius;
+    vec3 end_position; // the other end of a cylinder
+    uint type;
+    uint material_id;
+};
+
+struct Material {
+    vec3 color;
+    uint type;
+    float roughness;
+    float refractive_index;
+};
+
+layout(std430, binding = 8) buffer PrimitivesBuffer {
+    readonly AnalyticPrimitive primitives[];
+};
+
+layout(std430, binding = 9) buffer MaterialsBuffer {
+    readonly Material materials[];
+};
+
+layout(binding = 0) uniform samplerCube skyboxTexture;
+
+// written once per frame by the cpu (FrameUniforms.hpp has the same layout), every vec3 is followed by a float so nothing is padded
+layout(std140, binding = 0) uniform FrameUniforms {
+    mat4 inv_view_proj_mat;
+    mat4 portal_1_to_2;
+    mat4 portal_2_to_1;
+
+    vec3 camera_position;
+    float width;
+    vec3 octree_min_bounds;
+    float height;
+    vec3 octree_max_bounds;
+    uint max_recursion_limit;
+
+    vec3 portal_position_1;
+    float time;
+    vec3 portal_direction_1;
+    float blur_amount;
+    vec3 portal_position_2;
+    float portal_width;
+    vec3 portal_direction_2;
+    float portal_height;
+
+    float z_near;
+    float z_far;
+    uint samples_per_pixel;
+    uint accumulated_frame_count; // 0 when the accumulation starts over (the camera or the scene changed)
+};
+
+// the traced depth of the first sample, the resolve pass writes it into the depth buffer
+layout(r32f, binding = 1) uniform image2D depth_image;
+// linear hdr, the sum of the samples in rgb and their count in a, it is tone mapped by the resolve pass
+layout(rgba32f, binding = 2) uniform image2D accumulation_image;
+// the running mean of the luminance of the samples and the sum of the squared differences from it (welford), and in z the number of
+// samples traced into this accumulation (the reprojected ones aren't counted)
+layout(rgba32f, binding = 3) uniform image2D variance_image;
+// the guides of the denoiser: the normal and the distance of the primary hit, and the albedo of its material
+layout(rgba16f, binding = 4) uniform image2D normal_depth_image;
+layout(rgba8, binding = 5) uniform image2D albedo_image;
+
+// the convergence pass marks the tiles whose every pixel reached the target error, they aren't traced until the accumulation restarts
+#define CONVERGENCE_TILE_SIZE 8
+
+layout(std430, binding = 10) buffer ConvergenceMask {
+    uvec4 convergence_header; // x is the number of tiles that aren't converged
+    uint converged_tiles[];
+};
+
+
+struct Ray {
+    vec3 position;
+    vec3 direction;
+    vec3 inverse_direction;
+    float cone_width; // the ray cone (for the level of detail) is cone_width + distance * cone_spread wide
+    float cone_spread;
+};
+
+struct AABB {
+    vec3 min_bounds;
+    vec3 max_bounds;
+};
+
+struct HitInfo {
+    bool has_hit;
+    vec3 position;
+    vec3 normal;
+    uint material_id;
+    uint portal_id;
+};
+
+struct Sphere {
+    vec3 position;
+    float radius;
+};
+
+struct Portal {
+    vec3 position;
+    vec3 normal;
+};
+
+const float INFINITY = 1.0 / 0.0;
+const float PI = 3.1415926535897932384626433832795;
+
+const uint LAMBERTIAN = 0;
+const uint METAL = 1;
+const uint DIELECTRIC = 2;
+
+const uint PRIMITIVE_SPHERE = 0;
+const uint PRIMITIVE_CYLINDER = 1;
+
+const uint NO_PORTAL = 0;
+const uint PORTAL_1 = 1;
+const uint PORTAL_2 = 2;
+
+const uint NUM_OF_NEW_RAYS = 1;
+
+// the node has a simplified version of its subtree (see Octree::AssignLods), it is stored after the child pointers: start, count, feature size
+const uint LOD_NODE_FLAG = 0x80;
+
+
+float min3(vec3 a) {
+    return min(min(a.x, a.y), a.z);
+}
+
+float max3(vec3 a) {
+    return max(max(a.x, a.y), a.z);
+}
+
+
+
+
+// from https://gamedev.stackexchange.com/questions/23743/whats-the-most-efficient-way-to-find-barycentric-coordinates
+vec3 Barycentric(vec3 p, vec3 a, vec3 b, vec3 c) {
+    vec3 v0 = b - a;
+    vec3 v1 = c - a;
+    vec3 v2 = p - a;
+    float d00 = dot(v0, v0);
+    float d01 = dot(v0, v1);
+    float d11 = dot(v1, v1);
+    float d20 = dot(v2, v0);
+    float d21 = dot(v2, v1);
+    float denom = d00 * d11 - d01 * d01;
+    float v = (d11 * d20 - d01 * d21) / denom;
+    float w = (d00 * d21 - d01 * d20) / denom;
+    float u = 1.0f - v - w;
+
+    return vec3(u, v, w);
+}
+
+// from https://www.shadertoy.com/view/MtycDD
+float RaySphere(Ray ray, Sphere sphere, float closest_distance) {
+	vec3 oc = ray.position - sphere.position;
+    float b = dot(oc, ray.direction);
+    float c = dot(oc, oc) - sphere.radius * sphere.radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0) {
+        return INFINITY;
+    }
+
+	float s = sqrt(discriminant);
+	float t1 = -b - s;
+	float t2 = -b + s;
+	
+	float t = t1 < 0.0 ? t2 : t1;
+    if (t < closest_distance && t > 0.0) {
+	    return t;
+    } else {
+        return INFINITY;
+    }
+}
+
+// from https://github.com/btmxh/glsl-intersect/blob/master/3d/intersection/rayTriangle.glsl
+float RayTriangle(Ray ray, vec3 v1, vec3 v2, vec3 v3, float epsilon) {
+    vec3 e1 = v2 - v1;
+    vec3 e2 = v3 - v1;
+    vec3 pvec = cross(ray.direction, e2);
+    float det = dot(e1, pvec);
+
+    if (abs(det) < epsilon) {
+        return -1.0;
+    }
+
+    float invDet = 1.0 / det;
+    vec3 tvec = ray.position - v1;
+
+    float u = invDet * dot(tvec, pvec);
+    if (u < 0.0 || u > 1.0) {
+        return -1.0;
+    }
+
+    vec3 qvec = cross(tvec, e1);
+    float v = invDet * dot(ray.direction, qvec);
+
+    if (v < 0.0 || u + v > 1.0) {
+        return -1.0;
+    }
+
+    return dot(e2, qvec) * invDet;
+}
+
+// from https://www.shadertoy.com/view/tl23Rm
+float RayCylinder(Ray ray, vec3 pa, vec3 pb, float ra, float closest_distance, out vec3 normal) {
+    vec3 ca = pb - pa;
+    vec3 oc = ray.position - pa;
+
+    float caca = dot(ca, ca);
+    float card = dot(ca, ray.direction);
+    float caoc = dot(ca, oc);
+    
+    float a = caca - card * card;
+    float b = caca * dot(oc, ray.direction) - caoc * card;
+    float c = caca * dot(oc, oc) - caoc * caoc - ra * ra * caca;
+    float h = b * b - a * c;
+    
+    if (h < 0.0) {
+        return INFINITY;
+    }
+    
+    h = sqrt(h);
+    float d = (-b - h)/a;
+
+    float y = caoc + d * card;
+    if (y > 0.0 && y < caca && d >= 0.0 && d <= closest_distance) {
+        normal = (oc + d * ray.direction - ca * y / caca) / ra;
+        return d;
+    }
+
+    d = ((y < 0.0 ? 0.0 : caca) - caoc) / card;
+    
+    if( abs(b + a * d) < h && d >= 0.0 && d <= closest_distance) {
+        normal = normalize(ca * sign(y) / caca);
+        return d;
+    } else {
+        return INFINITY;
+    }
+}
+
+float RayPrimitive(Ray ray, AnalyticPrimitive primitive, float closest_distance, out vec3 normal) {
+    if (primitive.type == PRIMITIVE_SPHERE) {
+        float t = RaySphere(ray, Sphere(primitive.position, primitive.radius), closest_distance);
+        normal = normalize(ray.position + t * ray.direction - primitive.position);
+        return t;
+    } else {
+        return RayCylinder(ray, primitive.position, primitive.end_position, primitive.radius, closest_distance, normal);
+    }
+}
+
+float RayPortal(Ray ray, Portal portal, float closest_distance) {
+    float d = dot(portal.normal, ray.direction);
+    
+    if (abs(d) <= 0.0001) {
+        return INFINITY;
+    }
+
+    float t = dot((portal.position - ray.position), portal.normal) / d;
+    
+    if (t < 0.0 || t > closest_distance) {
+        return INFINITY;
+    }
+
+    vec3 intersect_point = ray.position + t * ray.direction;
+
+    vec3 plane_right = cross(portal.normal, vec3(0.0, 1.0, 0.0));
+    if (length(plane_right) <= 0.0001) {
+        return INFINITY;
+    }
+    
+    plane_right = normalize(plane_right);
+    vec3 plane_up = normalize(cross(plane_right, portal.normal));
+
+    vec3 c = intersect_point - portal.position;
+
+    if (abs(dot(plane_right, c)) < 0.5 * portal_width && abs(dot(plane_up, c)) < 0.5 * portal_height) {
+        return t;
+    } else {
+        return INFINITY;
+    }
+}
+
+float ComputeNonLinearDepth(float linear_depth) {
+    return (z_near * z_far - linear_depth * z_far) / (linear_depth * (z_near - z_far));
+}
+
+
+
+// from https://www.shadertoy.com/view/Xt3cDn
+uint baseHash(uvec2 p) {
+    p = 1103515245U*((p >> 1U)^(p.yx));
+    uint h32 = 1103515245U*((p.x)^(p.y>>3U));
+    return h32^(h32 >> 16);
+}
+
+// from https://www.shadertoy.com/view/Xt3cDn
+float hash1(inout float seed) {
+    uint n = baseHash(floatBitsToUint(vec2(seed+=.1,seed+=.1)));
+    return float(n)/float(0xffffffffU);
+}
+
+// from https://www.shadertoy.com/view/Xt3cDn
+vec2 hash2(inout float seed) {
+    uint n = baseHash(floatBitsToUint(vec2(seed+=.1,seed+=.1)));
+    uvec2 rz = uvec2(n, n*48271U);
+    return vec2(rz.xy & uvec2(0x7fffffffU))/float(0x7fffffff);
+}
+
+// from https://www.shadertoy.com/view/Xt3cDn
+vec3 hash3(inout float seed) {
+    uint n = baseHash(floatBitsToUint(vec2(seed+=.1,seed+=.1)));
+    uvec3 rz = uvec3(n, n*16807U, n*48271U);
+    return vec3(rz & uvec3(0x7fffffffU))/float(0x7fffffff);
+}
+
+// from https://www.shadertoy.com/view/MtycDD
+vec3 random_cos_weighted_hemisphere_direction(vec3 n, inout float seed) {
+  	vec2 r = hash2(seed);
+	vec3  uu = normalize(cross(n, abs(n.y) > .5 ? vec3(1.,0.,0.) : vec3(0.,1.,0.)));
+	vec3  vv = cross(uu, n);
+	float ra = sqrt(r.y);
+	float rx = ra*cos(6.28318530718*r.x); 
+	float ry = ra*sin(6.28318530718*r.x);
+	float rz = sqrt(1.-r.y);
+	vec3  rr = vec3(rx*uu + ry*vv + rz*n);
+    return normalize(rr);
+}
+
+// from https://www.shadertoy.com/view/MtycDD
+vec3 random_in_unit_sphere(inout float seed) {
+    vec3 h = hash3(seed) * vec3(2.,6.28318530718,1.)-vec3(1,0,0);
+    float phi = h.y;
+    float r = pow(h.z, 1./3.);
+	return r * vec3(sqrt(1.-h.x*h.x)*vec2(sin(phi),cos(phi)),h.x);
+}
+
+// from from: https://learnopengl.com/PBR/Lighting
+vec3 FresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// from https://www.shadertoy.com/view/tl23Rm
+float FresnelSchlickRoughness(float cosTheta, float F0, float roughness) {
+    return F0 + (max((1. - roughness), F0) - F0) * pow(abs(1. - cosTheta), 5.0);
+}
+
+
+bool RayAABB(const Ray ray, const AABB aabb, float closest_distance) {
+    vec3 t1 = (aabb.min_bounds - ray.position) * ray.inverse_direction;
+    vec3 t2 = (aabb.max_bounds - ray.position) * ray.inverse_direction;
+
+    float tmin = max3(min(t1, t2));
+    float tmax = min3(max(t1, t2));
+
+    return tmax > 0.0 && tmin < tmax && tmin < closest_distance;
+}
+
+float RayAABBEntry(const Ray ray, const AABB aabb) {
+    vec3 t1 = (aabb.min_bounds - ray.position) * ray.inverse_direction;
+    vec3 t2 = (aabb.max_bounds - ray.position) * ray.inverse_direction;
+
+    return max(max3(min(t1, t2)), 0.0);
+}
+
+HitInfo FindIntersection(Ray ray) {
+    float closest_distance = INFINITY;
+    uint closest_i;
+
+    AABB bounding_box_stack[1000];
+    uint node_start_stack[1000];
+    uint stack_size = 0;
+
+    uint closest_triangle_start;
+    bool triangle_intersect = false;
+    vec3 primitive_normal;
+
+    // the primitives are tested first, so the octree traversal is already limited by the closest one
+    for (uint i = 0; i < primitives.length(); i++) {
+        vec3 normal;
+        float t = RayPrimitive(ray, primitives[i], closest_distance, normal);
+        if (!isinf(t)) {
+            closest_distance = t;
+            closest_i = i;
+            primitive_normal = normal;
+        }
+    }
+
+    AABB bounding_box = AABB(octree_min_bounds, octree_max_bounds);
+
+    if (RayAABB(ray, bounding_box, closest_distance)) {
+        bounding_box_stack[0] = bounding_box;
+        node_start_stack[0] = 0;
+        stack_size = 1;
+    }
+
+    while (stack_size != 0) {
+        stack_size--;
+        AABB current_bounding_box = bounding_box_stack[stack_size];
+        uint current_node_start = node_start_stack[stack_size];
+
+        uint node_info = nodes[current_node_start];
+        uint triangle_start = nodes[current_node_start + 1];
+
+        uint child_count = node_info & uint(0x0000000F);
+        uint triangle_count = (node_info >> 16);
+
+        // once the simplified triangles are smaller than the ray cone they look the same, so the subtree isn't entered
+        if (bool(node_info & LOD_NODE_FLAG)) {
+            uint lod_start = current_node_start + 2 + child_count;
+            float cone_width = ray.cone_width + RayAABBEntry(ray, current_bounding_box) * ray.cone_spread;
+
+            if (cone_width >= uintBitsToFloat(nodes[lod_start + 2])) {
+                triangle_start = nodes[lod_start];
+                triangle_count = nodes[lod_start + 1];
+                node_info &= ~uint(0x0000FF00);
+            }
+        }
+
+        for (uint i = 0; i < triangle_count; i++) {
+            uvec4 ind = indecies[triangle_start + i];
+
+            vec3 v1 = vertecies[ind.x].xyz;
+            vec3 v2 = vertecies[ind.y].xyz;
+            vec3 v3 = vertecies[ind.z].xyz;
+
+            float t = RayTriangle(ray, v1, v2, v3, 0.000000000000001);
+            if (t >= 0.0 && t < closest_distance) {
+                closest_distance = t;
+                closest_triangle_start = triangle_start + i;
+                triangle_intersect = true;
+            }
+        }
+
+        uint child_pointers[8];
+        for (uint child_index = 0; child_index < child_count; child_index++) {
+            child_pointers[child_index] = nodes[current_node_start + 2 + child_index];
+        }
+
+        uint child_index = 0;
+        vec3 mid_point = (current_bounding_box.max_bounds + current_bounding_box.min_bounds) / 2.0;
+
+        for (uint i = 0; i < 8; i++) {
+            if (bool(node_info & (uint(0x00000100) << i))) {
+                vec3 child_min_bounds = vec3(
+                    bool(i & uint(1)) ? mid_point.x : current_bounding_box.min_bounds.x,
+                    bool(i & uint(2)) ? mid_point.y : current_bounding_box.min_bounds.y,
+                    bool(i & uint(4)) ? mid_point.z : current_bounding_box.min_bounds.z
+                );
+                vec3 child_max_bounds = vec3(
+                    bool(i & uint(1)) ? current_bounding_box.max_bounds.x : mid_point.x,
+                    bool(i & uint(2)) ? current_bounding_box.max_bounds.y : mid_point.y,
+                    bool(i & uint(4)) ? current_bounding_box.max_bounds.z : mid_point.z
+                );
+
+                AABB child_bounding_box = AABB(child_min_bounds, child_max_bounds);
+
+                if (RayAABB(ray, child_bounding_box, closest_distance)) {
+                    uint child_start = child_pointers[child_index];
+
+                    bounding_box_stack[stack_size] = child_bounding_box;
+                    node_start_stack[stack_size] = child_start;
+                    stack_size++;
+                }
+                child_index++;
+            }
+        }
+    }
+
+
+    float portal_1_t = RayPortal(ray, Portal(portal_position_1, portal_direction_1), closest_distance);
+    float portal_2_t = RayPortal(ray, Portal(portal_position_2, portal_direction_2), closest_distance);
+
+    if (!isinf(portal_1_t) && portal_1_t < portal_2_t) {
+        vec3 position = ray.position + portal_1_t * ray.direction;
+        return HitInfo(true, position, portal_direction_1, 0, PORTAL_1);
+    } else if (!isinf(portal_2_t) && portal_2_t < portal_1_t) {
+        vec3 position = ray.position + portal_2_t * ray.direction;
+        return HitInfo(true, position, portal_direction_2, 0, PORTAL_2);
+    }
+
+    if (isinf(closest_distance)) {
+        return HitInfo(false, vec3(0.0), vec3(0.0), 0, NO_PORTAL);
+    } else {
+        // a triangle is only accepted if it is closer than every primitive
+        if (triangle_intersect) {
+            uvec4 ind = indecies[closest_triangle_start];
+
+            vec3 v1 = vertecies[ind.x].xyz;
+            vec3 v2 = vertecies[ind.y].xyz;
+            vec3 v3 = vertecies[ind.z].xyz;
+
+            vec3 n1 = normals[ind.x].xyz;
+            vec3 n2 = normals[ind.y].xyz;
+            vec3 n3 = normals[ind.z].xyz;
+        
+            vec3 position = ray.position + closest_distance * ray.direction;
+            vec3 uvw = Barycentric(position, v1, v2, v3);
+            vec3 normal = uvw.x * n1 + uvw.y * n2 + uvw.z * n3;
+
+            return HitInfo(true, position, normal, ind.w, NO_PORTAL);
+        } else {
+            vec3 position = ray.position + closest_distance * ray.direction;
+            return HitInfo(true, position, primitive_normal, primitives[closest_i].material_id, NO_PORTAL);
+        }
+    }
+}
+
+
+// the ray continues through the portal or it is scattered by the material, color is the throughput of the path
+void ScatterRay(inout Ray ray, HitInfo hit_info, inout vec3 color, inout float seed) {
+    ray.cone_width += length(hit_info.position - ray.position) * ray.cone_spread;
+
+    if (hit_info.portal_id == PORTAL_1) {
+        if (dot(ray.direction, portal_direction_1) < 0.0) {
+            color *= 0.5;
+        } else {
+            color *= 0.05;
+        }
+
+        ray.position = (portal_1_to_2 * vec4((hit_info.position - portal_position_1), 1.0)).xyz + portal_position_2;
+        ray.direction = normalize((portal_1_to_2 * vec4(ray.direction, 0.0)).xyz);
+        ray.position += 0.001 * ray.direction;
+    } else if (hit_info.portal_id == PORTAL_2) {
+        if (dot(ray.direction, portal_direction_2) < 0.0) {
+            color *= 0.5;
+        } else {
+            color *= 0.05;
+        }
+
+        ray.position = (portal_2_to_1 * vec4((hit_info.position - portal_position_2), 1.0)).xyz + portal_position_1;
+        ray.direction = normalize((portal_2_to_1 * vec4(ray.direction, 0.0)).xyz);
+        ray.position += 0.001 * ray.direction;
+    } else if (hit_info.portal_id == NO_PORTAL) {
+        Material material = materials[hit_info.material_id];
+
+        if (material.type == LAMBERTIAN) {
+            float F = FresnelSchlickRoughness(max(-dot(ray.direction, hit_info.normal), 0.0), 0.04, material.roughness);
+
+            ray.position = hit_info.position + 0.001 * hit_info.normal;
+            if (hash1(seed) > F) {
+                color *= material.color;
+                ray.direction = random_cos_weighted_hemisphere_direction(hit_info.normal, seed);
+            } else {
+                ray.direction = normalize(reflect(ray.direction, hit_info.normal) + material.roughness * random_in_unit_sphere(seed));
+            }
+        } else if (material.type == METAL) {
+            ray.position = hit_info.position + 0.001 * hit_info.normal;
+            ray.direction = normalize(reflect(ray.direction, hit_info.normal) + material.roughness * random_in_unit_sphere(seed));
+
+            color *= material.color;
+        } else if (material.type == DIELECTRIC) {
+            float refractive_index;
+            float cosine;
+            vec3 outgoing_normal;
+
+            if (dot(ray.direction, hit_info.normal) > 0.0) {
+                refractive_index = material.refractive_index;
+                cosine = dot(ray.direction, hit_info.normal);
+                cosine = sqrt(1.0 - refractive_index * refractive_index * (1.0 - cosine * cosine));
+                outgoing_normal = -1.0 * hit_info.normal;
+            } else {
+                refractive_index = 1.0 / material.refractive_index;
+                cosine = -1.0 * dot(ray.direction, hit_info.normal);
+                outgoing_normal = hit_info.normal;
+            }
+
+            vec3 modified_direction = ray.direction + material.roughness * random_in_unit_sphere(seed);
+            vec3 refracted_direction = normalize(refract(modified_direction, outgoing_normal, refractive_index));
+
+            if (refracted_direction != vec3(0.0)) {
+                float r = (1.0 - refractive_index) / (1.0 + refractive_index);
+                float F = FresnelSchlickRoughness(cosine, r * r, material.roughness);
+                if (hash1(seed) > F) {
+                    ray.position = hit_info.position - 0.001 * outgoing_normal;
+                    ray.direction = refracted_direction;
+                } else {
+                    ray.position = hit_info.position + 0.001 * outgoing_normal;
+                    ray.direction = normalize(reflect(modified_direction, outgoing_normal));
+                }
+            } else {
+                // internal reflection
+                ray.position = hit_info.position - 0.001 * outgoing_normal;
+                ray.direction = normalize(reflect(modified_direction, outgoing_normal));
+            }
+        }
+    }
+
+    ray.inverse_direction = 1.0 / ray.direction;
+}
+
+float ComputePrimaryDepth(Ray ray, HitInfo hit_info) {
+    if (hit_info.has_hit) {
+        return clamp(ComputeNonLinearDepth(length(hit_info.position - ray.position)), 0.0, 1.0);
+    } else {
+        return clamp(ComputeNonLinearDepth(z_far), 0.0, 1.0);
+    }
+}
+
+// the depth (for the rasterization) and the guides of the denoiser come from the primary hit of the first sample
+void StorePrimaryHit(ivec2 pixel, Ray ray, HitInfo hit_info) {
+    imageStore(depth_image, pixel, vec4(ComputePrimaryDepth(ray, hit_info)));
+
+    // the misses and the portals have no normal, so the denoiser doesn't filter them (what is seen through a portal isn't on its plane)
+    vec3 normal = vec3(0.0);
+    float hit_distance = z_far;
+    vec3 albedo = vec3(1.0);
+    if (hit_info.has_hit) {
+        hit_distance = length(hit_info.position - ray.position);
+        if (hit_info.portal_id == NO_PORTAL) {
+            normal = hit_info.normal;
+            albedo = materials[hit_info.material_id].color;
+        }
+    }
+
+    imageStore(normal_depth_image, pixel, vec4(normal, hit_distance));
+    imageStore(albedo_image, pixel, vec4(albedo, 1.0));
+}
+
+void RayTrace(Ray r, inout float seed, out vec3 color, out HitInfo primary_hit_info) {
+    primary_hit_info = HitInfo(false, vec3(0.0), vec3(0.0), 0, NO_PORTAL);
+    color = vec3(1.0);
+
+    Ray ray = r;
+
+    for (uint i = 0; i < max_recursion_limit; i++) {
+        HitInfo hit_info = FindIntersection(ray);
+
+        if (i == 0) {
+            primary_hit_info = hit_info;
+        }
+
+        if (hit_info.has_hit) {
+            ScatterRay(ray, hit_info, color, seed);
+        } else {
+            color *= texture(skyboxTexture, ray.direction).xyz;
+            break;
+        }
+    }
+}
+
+// every sample of the pixel starts from a different seed
+Ray GenerateCameraRay(vec2 ndc_coord, uint sample_index, out float seed) {
+    vec4 projected_position = inv_view_proj_mat * vec4(ndc_coord, -1.0, 1.0);
+    projected_position /= projected_position.w;
+
+    seed = float(baseHash(floatBitsToUint(projected_position.xy - time) ^ uvec2(sample_index * 0x9E3779B9U)))/float(0xffffffffU);
+    seed = float(baseHash(floatBitsToUint(vec2(seed, seed))))/float(0xffffffffU);
+    
+    vec3 ray_dir = normalize(projected_position.xyz - (camera_position + blur_amount * random_in_unit_sphere(seed)));
+
+    // the cone spreads by the angle between the rays of neighbouring pixels
+    vec4 neighbour_position = inv_view_proj_mat * vec4(ndc_coord + vec2(2.0 / width, 0.0), -1.0, 1.0);
+    neighbour_position /= neighbour_position.w;
+    float cone_spread = distance(normalize(neighbour_position.xyz - camera_position), normalize(projected_position.xyz - camera_position));
+
+    return Ray(camera_position, ray_dir, (1.0 / ray_dir), 0.0, cone_spread);
+}
+
+bool IsPixelConverged(ivec2 pixel) {
+    if (accumulated_frame_count == 0) {
+        return false; // the mask belongs to the previous accumulation
+    }
+
+    uint tiles_per_row = (uint(imageSize(accumulation_image).x) + CONVERGENCE_TILE_SIZE - 1) / CONVERGENCE_TILE_SIZE;
+    uvec2 tile = uvec2(pixel) / CONVERGENCE_TILE_SIZE;
+    return converged_tiles[tile.y * tiles_per_row + tile.x] != 0;
+}
+
+struct PixelSamples {
+    vec4 accumulated; // the same as in the accumulation image
+    vec2 luminance_moments; // the same as in the variance image
+    float traced_sample_count;
+};
+
+PixelSamples LoadPixelSamples(ivec2 pixel, bool is_first_sample) {
+    if (is_first_sample) {
+        return PixelSamples(vec4(0.0), vec2(0.0), 0.0);
+    }
+    vec4 variance = imageLoad(variance_image, pixel);
+    return PixelSamples(imageLoad(accumulation_image, pixel), variance.xy, variance.z);
+}
+
+void AddSample(inout PixelSamples pixel_samples, vec3 color) {
+    pixel_samples.accumulated += vec4(color, 1.0);
+    pixel_samples.traced_sample_count += 1.0;
+
+    float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    float delta = luminance - pixel_samples.luminance_moments.x;
+    pixel_samples.luminance_moments.x += delta / pixel_samples.accumulated.a;
+    pixel_samples.luminance_moments.y += delta * (luminance - pixel_samples.luminance_moments.x);
+}
+
+void StorePixelSamples(ivec2 pixel, PixelSamples pixel_samples) {
+    imageStore(accumulation_image, pixel, pixel_samples.accumulated);
+    imageStore(variance_image, pixel, vec4(pixel_samples.luminance_moments, pixel_samples.traced_sample_count, 0.0));
+}
+
+// traces samples_per_pixel samples and adds them to the accumulation (nothing is traced once the tile of the pixel converged)
+void TracePixel(vec2 ndc_coord, ivec2 pixel) {
+    if (IsPixelConverged(pixel)) {
+        return;
+    }
+
+    PixelSamples pixel_samples = LoadPixelSamples(pixel, accumulated_frame_count == 0);
+
+    for (uint sample_index = 0; sample_index < samples_per_pixel; sample_index++) {
+        float seed;
+        Ray ray = GenerateCameraRay(ndc_coord, sample_index, seed);
+
+        vec3 color;
+        HitInfo primary_hit_info;
+        RayTrace(ray, seed, color, primary_hit_info);
+
+        AddSample(pixel_samples, color);
+        if (sample_index == 0) {
+            StorePrimaryHit(pixel, ray, primary_hit_info);
+        }
+    }
+
+    StorePixelSamples(pixel, pixel_samples);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#version 430
+
+// moves the results of the ray tracer into the framebuffer: the tone mapped average of the accumulated samples and the traced depth
+// (so the rasterized objects are hidden behind the traced scene)
+
+layout(r32f, binding = 1) readonly uniform image2D depth_image;
+layout(rgba32f, binding = 2) readonly uniform image2D accumulation_image;
+// the output of the denoiser, it is used instead of the average of the samples when is_denoised is set
+layout(rgba32f, binding = 6) readonly uniform image2D denoised_image;
+
+uniform bool is_denoised;
+
+out vec4 fs_out_col;
+
+vec3 Tonemap(vec3 color) {
+    color = max(vec3(0.0), color - 0.004);
+    return (color * (6.2 * color + 0.5)) / (color * (6.2 * color + 1.7) + 0.06);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec3 color;
+    if (is_denoised) {
+        color = imageLoad(denoised_image, pixel).rgb;
+    } else {
+        vec4 accumulated_samples = imageLoad(accumulation_image, pixel);
+        color = accumulated_samples.rgb / max(accumulated_samples.a, 1.0);
+    }
+
+    fs_out_col = vec4(Tonemap(color), 0.0);
+    gl_FragDepth = imageLoad(depth_image, pixel).x;
+}
\ No newline at end of file
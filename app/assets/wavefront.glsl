@@ -0,0 +1,75 @@
+// the queues of the wavefront ray tracer, it is included after ray_tracer.glsl
+// every stage is its own compute pass that reads a queue and appends to the next one, so a pass only runs the code of one stage
+// every queue starts with the indirect dispatch arguments of the pass that consumes it, the w component is the number of entries
+
+#define WAVEFRONT_GROUP_SIZE 64
+
+struct WavefrontRay {
+    vec4 position_cone_width;
+    vec4 direction_cone_spread;
+    vec4 color_seed; // the color is the throughput of the path
+    uvec4 pixel_bounce_sample;
+};
+
+struct WavefrontHit {
+    vec4 position;
+    vec4 normal;
+    uvec4 ray_material_portal; // the index of the ray in the incoming ray queue
+};
+
+layout(std430, binding = 4) buffer IncomingRayQueue {
+    uvec4 incoming_ray_dispatch;
+    WavefrontRay incoming_rays[];
+};
+
+layout(std430, binding = 5) buffer OutgoingRayQueue {
+    uvec4 outgoing_ray_dispatch;
+    WavefrontRay outgoing_rays[];
+};
+
+layout(std430, binding = 6) buffer HitQueue {
+    uvec4 hit_dispatch;
+    WavefrontHit hits[];
+};
+
+layout(std430, binding = 7) buffer MissQueue {
+    uvec4 miss_dispatch;
+    uint misses[];
+};
+
+// the entries are appended with atomics (so the queues stay compact) and the dispatch grows to cover the last one
+uint AppendOutgoingRay() {
+    uint index = atomicAdd(outgoing_ray_dispatch.w, 1);
+    atomicMax(outgoing_ray_dispatch.x, index / WAVEFRONT_GROUP_SIZE + 1);
+    return index;
+}
+
+uint AppendHit() {
+    uint index = atomicAdd(hit_dispatch.w, 1);
+    atomicMax(hit_dispatch.x, index / WAVEFRONT_GROUP_SIZE + 1);
+    return index;
+}
+
+uint AppendMiss() {
+    uint index = atomicAdd(miss_dispatch.w, 1);
+    atomicMax(miss_dispatch.x, index / WAVEFRONT_GROUP_SIZE + 1);
+    return index;
+}
+
+Ray LoadRay(WavefrontRay wavefront_ray) {
+    vec3 direction = wavefront_ray.direction_cone_spread.xyz;
+    return Ray(wavefront_ray.position_cone_width.xyz, direction, (1.0 / direction), wavefront_ray.position_cone_width.w, wavefront_ray.direction_cone_spread.w);
+}
+
+WavefrontRay StoreRay(Ray ray, vec3 color, float seed, uvec4 pixel_bounce_sample) {
+    return WavefrontRay(vec4(ray.position, ray.cone_width), vec4(ray.direction, ray.cone_spread), vec4(color, seed), pixel_bounce_sample);
+}
+
+// the samples of a pixel are traced by separate passes, so a path ends exactly once (with a miss or at the recursion limit) in a pass
+// and the pixel isn't written by anything else in it
+void FinishPath(uvec4 pixel_bounce_sample, vec3 color) {
+    ivec2 pixel = ivec2(pixel_bounce_sample.xy);
+    PixelSamples pixel_samples = LoadPixelSamples(pixel, accumulated_frame_count == 0 && pixel_bounce_sample.w == 0);
+    AddSample(pixel_samples, color);
+    StorePixelSamples(pixel, pixel_samples);
+}
\ No newline at end of file
@@ -15,14 +15,28 @@
 #include "Buffer.hpp"
 #include "Camera.hpp"
 #include "CameraManipulator.hpp"
+#include "ConvergenceMask.hpp"
+#include "Denoiser.hpp"
+#include "DynamicResolution.hpp"
 #include "Framebuffer.hpp"
+#include "FrameUniforms.hpp"
 #include "GLUtils.hpp"
 #include "Mesh.hpp"
 #include "ObjParser.hpp"
 #include "Octree.hpp"
 #include "Portal.hpp"
+#include "Reprojection.hpp"
+#include "RingBuffer.hpp"
+#include "ScenePrimitives.hpp"
 #include "Shader.hpp"
 #include "Skybox.hpp"
+#include "WavefrontRayTracer.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+
+enum class RayTracerMode { FRAGMENT, COMPUTE, WAVEFRONT };
 
 class App {
 public:
@@ -40,32 +54,81 @@ public:
     void Resize(GLsizei width, GLsizei height);
 
 private:
+    bool UploadOctreeChanges();
+    void UploadPrimitive(size_t index);
+    void UploadMaterial(size_t index);
+    // the scene changed so the accumulated samples are wrong, unlike after a camera move they can't be reprojected
+    void RestartAccumulation();
+    // resizes everything that has the render resolution (the window size times the scale)
+    void ResizeRenderTarget();
+    void UpdateLoading();
+    bool ContinueOctreeUpload();
+    bool IsSceneLoaded();
+    void WriteFrameUniforms();
+
     GLsizei m_width;
     GLsizei m_height;
+    // the ray tracing is done at this resolution, the result is scaled to the window
+    GLsizei m_render_width;
+    GLsizei m_render_height;
 
     Camera m_camera;
     CameraManipulator m_camera_manipulator;
     Framebuffer m_framebuffer;
     Shader m_ray_tracer_shader;
     Shader m_raster_shader;
-
-    Mesh m_mesh_1;
-    Mesh m_mesh_2;
-    Mesh m_mesh_3;
-
-    Octree m_octree;
+    Shader m_resolve_shader;
+
+    // the compute ray tracer is recompiled when its tile size changes (the tile size is the workgroup size)
+    RayTracerMode m_ray_tracer_mode = RayTracerMode::COMPUTE;
+    int m_tile_size_x_index;
+    int m_tile_size_y_index;
+    std::unique_ptr<Shader> m_compute_ray_tracer_shader;
+    WavefrontRayTracer m_wavefront_ray_tracer;
+    ConvergenceMask m_convergence_mask;
+    Denoiser m_denoiser;
+    Reprojection m_reprojection;
+    DynamicResolution m_dynamic_resolution;
+    bool m_is_dynamic_resolution_enabled = true;
+    float m_target_frame_milliseconds = 16.7f;
+    RingBuffer m_frame_uniforms;
+
+    std::unique_ptr<Octree> m_octree; // empty until the scene is loaded
+    std::vector<MeshHandle> m_inserted_meshes;
+    bool m_wobble_last_inserted = false;
+    std::vector<glm::vec4> m_wobble_rest_vertecies;
 
     Buffer m_vertecies_buffer;
     Buffer m_normal_buffer;
     Buffer m_indecies_buffer;
     Buffer m_node_buffer;
 
+    // the primitives and the materials can be edited at runtime, only the changed elements are uploaded
+    std::vector<AnalyticPrimitive> m_primitives;
+    std::vector<Material> m_materials;
+    Buffer m_primitive_buffer;
+    Buffer m_material_buffer;
+    int m_selected_primitive = 0;
+    int m_selected_material = 0;
+
     Skybox m_skybox;
 
     GLuint m_empty_vao; 
 
     float m_time_in_seconds;
     size_t m_still_frame_counter;
+    // the samples traced per pixel in a frame, they are added to the accumulation with their count so it can change any time
+    int m_samples_per_pixel = 1;
+    bool m_adaptive_sampling = true;
+    float m_target_error = 0.01f;
+    bool m_denoise = true;
+    int m_denoise_iteration_count = 4;
+    bool m_reproject = true;
+    int m_history_limit = 32;
+    bool m_is_history_valid = false;
+    // the camera of the previous frame, the accumulation is reprojected from it after a camera move
+    glm::mat4 m_previous_view_proj{1.0f};
+    glm::vec3 m_previous_camera_position{0.0f};
 
     Portal m_portal_1;
     Portal m_portal_2;
@@ -73,7 +136,20 @@ private:
     float m_portal_width;
     float m_portal_height;
 
+    // the scene is loaded on the shared thread pool, UpdateLoading picks up the results on the main thread
+    std::future<std::vector<SDL_Surface*>> m_skybox_future;
+    std::future<std::shared_ptr<const MeshObject<Vertex>>> m_suzanne_future;
+    std::future<std::unique_ptr<Octree>> m_octree_future;
+    std::shared_ptr<std::atomic<size_t>> m_loaded_scene_mesh_count;
+    size_t m_scene_mesh_count = 0;
+    bool m_is_streamed_scene = false; // the octree of a streamed build can't be edited
+    // the loaded octree is uploaded over several frames and only swapped in once all of it is on the gpu
+    std::unique_ptr<Octree> m_uploading_octree;
+    size_t m_uploaded_octree_bytes = 0;
+    size_t m_octree_byte_count = 0;
+
     OGLObject m_Suzanne;
+    std::shared_ptr<const MeshObject<Vertex>> m_suzanne_mesh_cpu; // kept so inserting suzanne into the octree doesn't parse the file again
     GLuint m_metalTextureID;
 
     glm::vec3 m_lightDir = glm::vec3(-1.0, -2.0, -0.5);
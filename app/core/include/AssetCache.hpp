@@ -0,0 +1,36 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "GLUtils.hpp"
+#include "Mesh.hpp"
+
+// loaded assets are shared between everyone that asks for the same file, an entry is identified by the canonical path and the
+// modification time (so a changed file is loaded again) and only weak references are kept, the data is freed with its last user
+// the returned data is immutable, instances place it with their own transform and material (see MeshInstance)
+class AssetCache {
+public:
+    static AssetCache& Shared();
+
+    // untransformed with material 0
+    std::shared_ptr<const Mesh> GetMesh(const std::filesystem::path& filename);
+    // parsed for rasterization (with the normals of the file)
+    std::shared_ptr<const MeshObject<Vertex>> GetMeshObject(const std::filesystem::path& filename);
+
+private:
+    using Key = std::pair<std::string, std::filesystem::file_time_type>;
+
+    static Key GetKey(const std::filesystem::path& filename);
+
+    template <typename T, typename F>
+    std::shared_ptr<const T> GetOrLoad(std::map<Key, std::weak_ptr<const T>>& entries, const std::filesystem::path& filename, F&& load);
+
+    std::mutex m_mutex;
+    std::map<Key, std::weak_ptr<const Mesh>> m_meshes;
+    std::map<Key, std::weak_ptr<const MeshObject<Vertex>>> m_mesh_objects;
+};
\ No newline at end of file
@@ -5,11 +5,19 @@
 
 class Buffer {
 public:
-    Buffer(GLsizeiptr size, const void* data);
+    Buffer(GLsizeiptr size, const void* data, GLbitfield flags = 0);
     ~Buffer();
 
     void Bind(GLuint index);
+    // needs GL_DYNAMIC_STORAGE_BIT
+    void Update(GLintptr offset, GLsizeiptr size, const void* data);
+    // the storage is immutable so the buffer is recreated with the same flags
+    void Resize(GLsizeiptr size, const void* data);
+    GLsizeiptr GetSize();
+    GLuint GetBufferID();
 
 private:
     GLuint m_buffer_id;
+    GLsizeiptr m_size;
+    GLbitfield m_flags;
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "Buffer.hpp"
+#include "Shader.hpp"
+
+// adaptive sampling: after every frame a pass marks the tiles whose every pixel reached the target error (the standard error of its
+// mean luminance relative to the mean), the ray tracers skip the pixels of the marked tiles until the accumulation restarts
+class ConvergenceMask {
+public:
+    ConvergenceMask(GLsizei width, GLsizei height);
+    ~ConvergenceMask();
+
+    void Resize(GLsizei width, GLsizei height);
+    // the framebuffer has to be bound (the accumulation and the variance are the images 2 and 3), so do the frame uniforms
+    // a target error of 0 turns the adaptive sampling off, is_restart drops the counts that were measured before the restart
+    void Update(float target_error, bool is_restart);
+    void Bind(GLuint index);
+
+    // from the last update whose result reached the cpu, it never waits for the gpu
+    GLuint GetActiveTileCount();
+    GLuint GetTileCount();
+    bool IsConverged();
+
+private:
+    void ReadActiveTileCount();
+    void DropReadback();
+
+    GLuint m_tile_count_x;
+    GLuint m_tile_count_y;
+
+    Shader m_convergence_shader;
+    Buffer m_mask_buffer;
+    // the header is copied here after every update and read once its fence is signaled
+    Buffer m_readback_buffer;
+    GLsync m_readback_fence = nullptr;
+    GLuint m_active_tile_count;
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+
+#include "Shader.hpp"
+#include "Texture2D.hpp"
+
+// an edge-avoiding a-trous wavelet filter (the spatial part of svgf) over the accumulated samples, it is guided by the normal, the
+// distance and the albedo of the primary hits and by the variance of the samples
+class Denoiser {
+public:
+    Denoiser(GLsizei width, GLsizei height);
+
+    void Resize(GLsizei width, GLsizei height);
+    // the framebuffer has to be bound (the accumulation, the variance and the guides are the images 2-5)
+    // every iteration doubles the radius of the filter, the result is left bound as the image 6 for the resolve pass
+    void Denoise(int iteration_count);
+
+private:
+    GLsizei m_width;
+    GLsizei m_height;
+
+    Shader m_denoise_shader;
+    // the iterations read one and write the other
+    std::array<Texture2D, 2> m_illumination_textures;
+};
\ No newline at end of file
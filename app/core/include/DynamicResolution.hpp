@@ -0,0 +1,41 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+
+// picks the scale of the render resolution from the gpu time of the frames, so the frame time stays close to a target
+// the time is measured with timestamp queries that are read a few frames later, the rendering never waits for them
+class DynamicResolution {
+public:
+    static constexpr float MIN_SCALE = 0.25f;
+    static constexpr float MAX_SCALE = 1.0f;
+
+    DynamicResolution();
+    ~DynamicResolution();
+
+    // around everything the gpu does for the frame
+    void BeginFrame();
+    void EndFrame();
+
+    // moves the scale towards the target frame time (in steps, so the resolution doesn't change every frame), returns true if it
+    // changed, the frames that are still measured at the old scale are ignored
+    bool UpdateScale(float target_milliseconds);
+    void SetScale(float scale);
+    float GetScale();
+    // the gpu time of the last measured frame
+    float GetFrameMilliseconds();
+
+private:
+    static constexpr size_t QUERY_FRAME_COUNT = 3;
+
+    std::array<GLuint, 2 * QUERY_FRAME_COUNT> m_timestamp_queries;
+    std::array<float, QUERY_FRAME_COUNT> m_query_scales{};
+    std::array<bool, QUERY_FRAME_COUNT> m_is_query_pending{};
+    size_t m_current_frame = 0;
+
+    float m_scale = MAX_SCALE;
+    float m_frame_milliseconds = 0.0f;
+    bool m_has_new_measurement = false;
+};
\ No newline at end of file
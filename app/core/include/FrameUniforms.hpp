@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// the FrameUniforms block of ray_tracer.glsl (std140), every vec3 is followed by a scalar so the members are packed the same way
+struct FrameUniforms {
+    glm::mat4 inv_view_proj_mat;
+    glm::mat4 portal_1_to_2;
+    glm::mat4 portal_2_to_1;
+
+    glm::vec3 camera_position;
+    GLfloat width;
+    glm::vec3 octree_min_bounds;
+    GLfloat height;
+    glm::vec3 octree_max_bounds;
+    GLuint max_recursion_limit;
+
+    glm::vec3 portal_position_1;
+    GLfloat time;
+    glm::vec3 portal_direction_1;
+    GLfloat blur_amount;
+    glm::vec3 portal_position_2;
+    GLfloat portal_width;
+    glm::vec3 portal_direction_2;
+    GLfloat portal_height;
+
+    GLfloat z_near;
+    GLfloat z_far;
+    GLuint samples_per_pixel;
+    GLuint accumulated_frame_count; // 0 starts the accumulation over
+};
+
+static_assert(sizeof(FrameUniforms) == 3 * 64 + 7 * 16 + 4 * 4, "FrameUniforms doesn't match the std140 layout");
\ No newline at end of file
@@ -11,9 +11,14 @@ public:
 
     void Bind();
     void UnBind();
-    void Blit();
+    // scales the target to the given size
+    void Blit(GLsizei window_width, GLsizei window_height);
     void Resize(GLsizei width, GLsizei height);
 
+    Texture2D& GetAccumulationTexture();
+    Texture2D& GetVarianceTexture();
+    Texture2D& GetNormalDepthTexture();
+
 private:
     GLsizei m_width;
     GLsizei m_height;
@@ -21,4 +26,10 @@ private:
     GLuint m_framebuffer_id;
     GLuint m_depthbuffer_id;
     Texture2D m_target_texture;
+    Texture2D m_depth_texture; // the ray tracers can't write the depth buffer from compute shaders, they store the depth here instead
+    Texture2D m_accumulation_texture; // the sum of the linear samples of every pixel (rgb) and their count (a)
+    Texture2D m_variance_texture; // the running mean and the sum of the squared differences of the luminance of the samples, and the traced sample count
+    // the guides of the denoiser from the primary hits
+    Texture2D m_normal_depth_texture;
+    Texture2D m_albedo_texture;
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+// read only view of a whole file, it is memory mapped where mmap is available (with sequential access hints)
+// so nothing is copied and the pages are read in on demand, elsewhere the file is read into a buffer
+class MappedFile {
+public:
+    MappedFile(const std::filesystem::path& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const;
+    const char* GetData() const;
+    size_t GetSize() const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_is_open;
+    bool m_is_mapped;
+    std::vector<char> m_fallback_data;
+};
\ No newline at end of file
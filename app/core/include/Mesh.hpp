@@ -4,16 +4,41 @@
 #include <glm/glm.hpp>
 
 #include <filesystem>
+#include <memory>
 #include <vector>
 
+#include "GLUtils.hpp"
+
 class Mesh {
 public:
+    // .rtmesh files (see MeshFile.hpp) are memory mapped and copied as they are, .ply files (see PlyFile.hpp) are decoded
+    // straight from the mapped pages, everything else is loaded as obj
     Mesh(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform);
+    // for meshes that are already parsed for rasterization
+    Mesh(const MeshObject<Vertex>& mesh_object, size_t material_id, glm::mat4 transform);
     ~Mesh();
 
+    // simplifies the mesh into m_lod_triangles, it is slow so it is meant to be done offline (mesh_converter stores them in the mesh file)
+    void GenerateLods();
+
     // using vec4 because glsl alligns vec3 to 16 bytes so for increased memmory usage it makes it faster and more convinient for me :)
     std::vector<glm::vec4> m_vertecies; 
     std::vector<glm::vec4> m_normals;
     std::vector<glm::uvec4> m_triangles;
+    // m_lod_triangles[i] has about 1 / 4^(i + 1) of the triangles, they index the same vertecies (empty if the mesh has no levels of detail)
+    std::vector<std::vector<glm::uvec4>> m_lod_triangles;
 private:
-};
\ No newline at end of file
+    void LoadMeshObject(const MeshObject<Vertex>& mesh_object, size_t material_id, glm::mat4 transform);
+    void LoadMeshFile(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform);
+    void LoadPlyFile(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform);
+};
+
+// a placement of mesh data that is shared between several instances (see AssetCache), the octree applies the transform and the material when it merges the meshes
+struct MeshInstance {
+    std::shared_ptr<const Mesh> mesh;
+    size_t material_id;
+    glm::mat4 transform;
+};
+
+// destination[i] = transform * source[i], source and destination can be the same
+void TransformVertecies(const glm::mat4& transform, const glm::vec4* source, glm::vec4* destination, size_t count);
\ No newline at end of file
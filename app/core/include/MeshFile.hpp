@@ -0,0 +1,38 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// binary mesh format (.rtmesh, little endian): the header is followed by the vertecies, normals (both vec4) and triangles (uvec4)
+// every array starts at a 16 byte aligned offset so it can be copied into the octree and the gpu buffers as it is
+// the levels of detail (see MeshSimplifier.hpp) are described by a table of MeshFileLod at lod_table_offset
+struct MeshFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t material_id; // the w component of the stored triangles
+    uint64_t vertex_count;
+    uint64_t triangle_count;
+    uint64_t vertecies_offset;
+    uint64_t normals_offset;
+    uint64_t triangles_offset;
+    uint64_t lod_count;
+    uint64_t lod_table_offset;
+};
+
+struct MeshFileLod {
+    uint64_t triangles_offset;
+    uint64_t triangle_count;
+};
+
+constexpr std::array<char, 8> MESH_FILE_MAGIC = {'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0'};
+constexpr uint32_t MESH_FILE_VERSION = 2;
+constexpr const char* MESH_FILE_EXTENSION = ".rtmesh";
+
+// only reads the header, false if the file can't be read or was written with an other version of the format
+bool IsCurrentMeshFile(const std::filesystem::path& filename);
+bool WriteMeshFile(const std::filesystem::path& filename, const std::vector<glm::vec4>& vertecies, const std::vector<glm::vec4>& normals, const std::vector<glm::uvec4>& triangles, const std::vector<std::vector<glm::uvec4>>& lod_triangles, uint32_t material_id);
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// levels of detail from quadric error edge collapses (garland and heckbert), every edge collapses into one of its end points so the
+// simplified triangles index the same vertecies (and normals) as the original ones, the materials are kept
+// result[i] has about 1 / 4^(i + 1) of the triangles, the levels stop at min_triangle_count or when nothing can be collapsed anymore
+std::vector<std::vector<glm::uvec4>> SimplifyMesh(const std::vector<glm::vec4>& vertecies, const std::vector<glm::uvec4>& triangles, size_t min_triangle_count);
\ No newline at end of file
@@ -3,7 +3,6 @@
 #include <filesystem>
 #include <fstream>
 #include <vector>
-#include <unordered_map>
 #include <functional>
 
 #include "GLUtils.hpp"
@@ -15,9 +14,24 @@ public:
 
 	typedef MeshObject<Vertex> Mesh;
 
-	static Mesh parse(const std::filesystem::path& fileName);
+	// the file is split into chunks at line boundaries that are parsed on the shared thread pool,
+	// the result is the same as with parallel = false (a single chunk)
+	// faces without normals get a normal per triangle, or with smoothNormals the normals of the triangles around each position summed up
+	static Mesh parse(const std::filesystem::path& fileName, bool parallel = true, bool smoothNormals = false);
 
-	enum Exception { EXC_FILENOTFOUND };
+	// for files that are too big to be parsed as a whole: the file is parsed in windows of about windowSize bytes (each one split into chunks
+	// like in parse), after each window its new vertices are passed to onVertices (their indices continue the ones of the previous windows)
+	// and then its triangles to onTriangles, so no vertex array of the whole file is kept here
+	// the normals the faces don't have are only known once the whole file is read, they are passed to onGeneratedNormal with the index
+	// of their vertex at the end (the normal of those vertices is zero until then)
+	// the vertices are the same as the ones of parse with smoothNormals, only the faces can't use
+	// positions or normals that are defined after their window (exporters write them before the faces anyways)
+	static void parseStreamed(const std::filesystem::path& fileName, size_t windowSize,
+		const std::function<void(const std::vector<Vertex>&)>& onVertices,
+		const std::function<void(const std::vector<unsigned int>&)>& onTriangles,
+		const std::function<void(unsigned int, const glm::vec3&)>& onGeneratedNormal);
+
+	enum Exception { EXC_FILENOTFOUND, EXC_FORWARDREFERENCE };
 
 private:
 	struct IndexedVert
@@ -52,4 +66,11 @@ private:
 	{
 		std::size_t operator()( const IndexedVert& iv ) const noexcept;
 	};
+
+	struct IndexedVertTable;
+
+	struct Chunk;
+	static std::vector<Chunk> splitIntoChunks( const char* data, size_t size, bool parallel );
+	static void parseRecords( Chunk& chunk );
+	static void triangulateFaces( Chunk& chunk, const std::vector<glm::vec3>& positions );
 };
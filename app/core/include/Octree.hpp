@@ -7,6 +7,8 @@
 #include <array>
 #include <memory>
 #include <cstdint>
+#include <limits>
+#include <filesystem>
 
 #include "Mesh.hpp"
 
@@ -20,22 +22,108 @@ struct OctreeNode {
     std::vector<glm::uvec4> triangles;
     std::array<std::unique_ptr<OctreeNode>, 8> childrens;
     bool is_leaf;
+
+    // where the node was written in the compressed buffers (a size of 0 means it was never written), so incremental updates can patch it
+    size_t compressed_node_start = 0;
+    size_t compressed_node_capacity = 0;
+    size_t compressed_triangle_start = 0;
+    size_t compressed_triangle_capacity = 0;
+
+    bool triangles_changed = false;
+    bool subtree_changed = false;
+
+    // a simplified version of everything in the subtree, the shader uses it instead of descending when the ray cone is wider than
+    // lod_feature_size (only set by the initial build, it is dropped when the subtree changes)
+    std::vector<glm::uvec4> lod_triangles{};
+    float lod_feature_size = 0.0f;
+    size_t compressed_lod_triangle_start = 0;
+    size_t compressed_lod_triangle_capacity = 0;
 };
 
+// byte ranges of the octree buffers that were modified since the last TakeDirtyRanges call
+struct DirtyRange {
+    size_t offset;
+    size_t size;
+};
+
+struct OctreeDirtyRanges {
+    std::vector<DirtyRange> vertecies;
+    std::vector<DirtyRange> normals;
+    std::vector<DirtyRange> nodes;
+    std::vector<DirtyRange> triangles;
+};
+
+// first fit allocator over the elements of a buffer that only grows, the caller resizes the buffer to the returned end
+class FreeListAllocator {
+public:
+    size_t Allocate(size_t size, size_t& buffer_end);
+    void Free(size_t start, size_t size);
+    void Clear();
+
+private:
+    std::vector<std::pair<size_t, size_t>> m_free_ranges; // sorted by start, neighbouring ranges are always merged
+};
+
+using MeshHandle = size_t;
+// returned by Insert when the mesh couldn't be added (streamed octrees can't be modified)
+constexpr MeshHandle INVALID_MESH_HANDLE = std::numeric_limits<MeshHandle>::max();
+
+class TriangleSpillFile;
+
 class Octree {
 public:
-    Octree(std::vector<Mesh> meshes, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps);
+    Octree(std::vector<Mesh>&& meshes, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps);
+    // the instances share their mesh data, the transform and the material of each one are applied while the meshes are merged
+    Octree(const std::vector<MeshInstance>& instances, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps);
+    // streaming build for obj files that are too big to build in memory: the file is parsed window by window (ObjParser::parseStreamed),
+    // the faces are spilled to temporary files and binned into
+    // octants until an octant has at most max_triangles_in_memory triangles, then that subtree is built and compressed on its own
+    // (an octant at the depth limit can't be split, its triangles are copied from the spill file to the compressed buffer without a node)
+    // (only the vertecies and normals are kept in memory for the whole build, they are needed on the gpu anyways)
+    // incremental updates need the whole tree in memory so they are not available after a streamed build
+    Octree(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform, size_t max_triangles_in_memory, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps);
     ~Octree();
 
     glm::vec3 GetMinBounds();
     glm::vec3 GetMaxBounds();
 
+    // the meshes passed to the constructor get the handles 0, 1, 2 ... in order
+    // only the subtrees the mesh overlaps are touched, unless it reaches outside of the root bounds in which case the whole tree is rebuilt
+    // the placement is applied with translation (unlike the transform of a Mesh), so the mesh is only inserted once where it ends up
+    MeshHandle Insert(Mesh&& mesh, const glm::mat4& placement = glm::mat4{1.0f});
+    void Remove(MeshHandle handle);
+    // the transform is applied on top of the current placement of the mesh
+    void Update(MeshHandle handle, const glm::mat4& transform);
+    // for deforming meshes (same topology, new positions): the tree isn't rebuilt, only the triangles that moved are
+    // removed from the cells they left and inserted into the ones they entered, the normals are optional (empty keeps the old ones)
+    void Refit(MeshHandle handle, const std::vector<glm::vec4>& vertecies, const std::vector<glm::vec4>& normals);
+    std::vector<glm::vec4> GetMeshVertecies(MeshHandle handle);
+
+    OctreeDirtyRanges TakeDirtyRanges();
+
     std::vector<glm::vec4> m_vertecies;
     std::vector<glm::vec4> m_normals;
     std::vector<uint32_t> m_compressed_node_buffer;
     std::vector<glm::uvec4> m_compressed_triangles;
 
 private:
+    struct MeshRecord {
+        size_t vertex_start;
+        size_t vertex_count;
+        bool is_alive;
+        std::vector<glm::uvec4> triangles; // only filled when the mesh is refitted the first time
+    };
+
+    void BuildMerged(std::vector<glm::uvec4>&& triangles, glm::vec3 min_bounds, glm::vec3 max_bounds, const std::vector<std::vector<glm::uvec4>>& lod_levels);
+    void Build(std::vector<glm::uvec4>&& triangles, AABB bounds, const std::vector<std::vector<glm::uvec4>>& lod_levels = {});
+    size_t AssignLods(std::unique_ptr<OctreeNode>& node, const std::vector<std::vector<glm::uvec4>>& lod_levels, const std::vector<std::vector<uint32_t>>& candidates);
+    void StreamObjFile(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform, TriangleSpillFile& triangles);
+    void StreamBuild(const AABB& bounds, TriangleSpillFile& triangles, size_t max_triangles_in_memory, size_t current_depth, size_t parent_node_child_pointer_location);
+    bool CanModifyTree();
+    bool IsLiveMesh(MeshHandle handle);
+    void TransformMeshVertecies(size_t vertex_start, size_t vertex_count, const glm::mat4& transform);
+    void Rebuild(std::vector<glm::uvec4>&& additional_triangles);
+
     void DepthFirstCompress(std::unique_ptr<OctreeNode>& node, size_t parent_node_child_pointer_location);
     void Subdivide(std::unique_ptr<OctreeNode>& node, size_t current_depth);
     void DepthFirstTraverse(
@@ -46,6 +134,18 @@ private:
         std::vector<size_t>& leaf_depths
     );
 
+    void InsertTriangles(std::vector<glm::uvec4>&& triangles, const AABB& mesh_bounds);
+    bool InsertTriangle(std::unique_ptr<OctreeNode>& node, const glm::uvec4& triangle, size_t current_depth);
+    bool RemoveTriangles(std::unique_ptr<OctreeNode>& node, const AABB& mesh_bounds, size_t vertex_start, size_t vertex_end, std::vector<glm::uvec4>& removed_triangles);
+    void CollectTriangles(std::unique_ptr<OctreeNode>& node, std::vector<glm::uvec4>& triangles);
+    void CollectMeshTriangles(std::unique_ptr<OctreeNode>& node, const AABB& mesh_bounds, size_t vertex_start, size_t vertex_end, std::vector<glm::uvec4>& triangles);
+    bool RefitTriangle(std::unique_ptr<OctreeNode>& node, const glm::uvec4& triangle, const AABB& previous_bounds, size_t current_depth);
+    bool RemoveTriangle(std::unique_ptr<OctreeNode>& node, const glm::uvec4& triangle, const AABB& previous_bounds);
+    void RecompressChanged(std::unique_ptr<OctreeNode>& node);
+    void FreeCompressedNode(OctreeNode& node);
+    AABB ComputeMeshBounds(const MeshRecord& record);
+    bool IsInsideBounds(const AABB& bounds);
+
     std::unique_ptr<OctreeNode> m_root;
     size_t m_max_depth;
 
@@ -53,4 +153,12 @@ private:
     const size_t m_max_triangles_per_node; // it shouldn't have more than 65536 (2^16)
     const size_t m_max_triangles_per_leaf; // a leaf could have more triangles than this limit if it is at the depth limit, it shouldn't have more than 65536 (2^16)
     const size_t m_keep_triangles_after_this_many_overlaps; // if lets say this is set at 5 and a triangle intersects at least 5 childrens aabb than that triangle won't be copied into the childrens rather it will be kept in the node 
+
+    std::vector<MeshRecord> m_meshes;
+    FreeListAllocator m_vertex_allocator;
+    FreeListAllocator m_node_allocator;
+    FreeListAllocator m_triangle_allocator;
+    OctreeDirtyRanges m_dirty_ranges;
+
+    bool m_is_streamed = false;
 };
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// binary stanford polygon files (.ply, little or big endian): only the vertex positions and normals and the face indecies are read,
+// every other element and property is skipped, faces with more than 3 vertecies are triangulated as fans
+constexpr const char* PLY_FILE_EXTENSION = ".ply";
+
+// the normals are left empty if the file has none, on failure error describes the problem
+bool ReadPlyFile(const char* data, size_t size, std::vector<glm::vec4>& vertecies, std::vector<glm::vec4>& normals, std::vector<glm::uvec4>& triangles, GLuint material_id, std::string& error);
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Framebuffer.hpp"
+#include "Shader.hpp"
+#include "Texture2D.hpp"
+
+// keeps the accumulated samples when the camera moves: the accumulation of the previous frame is saved before the restarted frame
+// is traced, then every pixel adds the samples that saw the same surface in the previous frame to its new ones
+class Reprojection {
+public:
+    Reprojection(GLsizei width, GLsizei height);
+
+    void Resize(GLsizei width, GLsizei height);
+    // has to be called before the restarted frame is traced
+    void SaveHistory(Framebuffer& framebuffer);
+    // after the restarted frame is traced, the framebuffer has to be bound (the accumulation, the variance and the guides are the
+    // images 2-4) and so do the frame uniforms of the new camera
+    void Reproject(const glm::mat4& previous_view_proj, const glm::vec3& previous_camera_position, GLuint history_limit);
+
+private:
+    GLsizei m_width;
+    GLsizei m_height;
+
+    Shader m_reproject_shader;
+    Texture2D m_history_accumulation_texture;
+    Texture2D m_history_variance_texture;
+    Texture2D m_history_normal_depth_texture;
+};
\ No newline at end of file
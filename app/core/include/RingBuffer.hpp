@@ -0,0 +1,28 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <cstddef>
+
+// a buffer that stays mapped for its whole life, it is split into slots that the cpu writes in turn (one per frame)
+// every slot is guarded by a fence, so a slot is only rewritten once the gpu finished the frame that used it
+class RingBuffer {
+public:
+    RingBuffer(GLsizeiptr slot_size, size_t slot_count);
+    ~RingBuffer();
+
+    // moves to the next slot and returns where it can be written, it only waits if the gpu is slot_count frames behind
+    void* MapNextSlot();
+    void BindUniform(GLuint index);
+    // has to be called after the last command that reads the current slot
+    void FenceCurrentSlot();
+
+private:
+    GLuint m_buffer_id;
+    GLsizeiptr m_slot_size; // rounded up to the uniform buffer offset alignment
+    size_t m_slot_count;
+    size_t m_current_slot;
+    char* m_mapped_data;
+    std::vector<GLsync> m_fences;
+};
\ No newline at end of file
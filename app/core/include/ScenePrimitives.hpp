@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// the analytic (non triangle) objects of the scene, the shader intersects every one of them with every ray
+// the layouts match the std430 structs in ray_tracer.glsl
+
+enum PrimitiveType : GLuint { PRIMITIVE_SPHERE = 0, PRIMITIVE_CYLINDER = 1 };
+
+struct AnalyticPrimitive {
+    glm::vec3 position; // the center of a sphere, one end of a cylinder
+    GLfloat radius;
+    glm::vec3 end_position; // the other end of a cylinder
+    GLuint type;
+    GLuint material_id;
+    GLuint padding[3];
+};
+
+enum MaterialType : GLuint { MATERIAL_LAMBERTIAN = 0, MATERIAL_METAL = 1, MATERIAL_DIELECTRIC = 2 };
+
+struct Material {
+    glm::vec3 color;
+    GLuint type;
+    GLfloat roughness;
+    GLfloat refractive_index;
+    GLfloat padding[2];
+};
+
+static_assert(sizeof(AnalyticPrimitive) == 48, "AnalyticPrimitive doesn't match the std430 layout");
+static_assert(sizeof(Material) == 32, "Material doesn't match the std430 layout");
+
+AnalyticPrimitive MakeSphere(glm::vec3 center, float radius, size_t material_id);
+AnalyticPrimitive MakeCylinder(glm::vec3 start_position, glm::vec3 end_position, float radius, size_t material_id);
+
+std::vector<Material> GetSceneMaterials();
+std::vector<AnalyticPrimitive> GetScenePrimitives();
\ No newline at end of file
@@ -3,16 +3,25 @@
 #include <GL/glew.h>
 
 #include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
 
 class Shader {
 public:
     Shader(const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename);
+    // compute program, every define ("NAME VALUE") is inserted after the #version line
+    Shader(const std::filesystem::path& cs_filename, const std::vector<std::string>& defines = {});
     ~Shader();
 
     void Use();
+    // the locations are looked up once after linking, -1 if the program has no such uniform
     GLint ul(const GLchar* name);
     GLuint GetProgramID();
 
 private:
+    void CacheUniformLocations();
+
     GLuint m_program_id;
+    std::vector<std::pair<std::string, GLint>> m_uniform_locations; // sorted by name
 };
\ No newline at end of file
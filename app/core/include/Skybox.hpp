@@ -1,12 +1,21 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+#include <vector>
 
 class Skybox {
 public:
+	// starts out as a black placeholder until the faces are uploaded
 	Skybox();
 	~Skybox();
 
+	// only decodes the images, so it can run on a worker thread
+	static std::vector<SDL_Surface*> LoadFaces();
+	// needs the gl context, the surfaces are freed
+	void Upload(std::vector<SDL_Surface*>& faces);
+
 	GLuint GetTextureID();
 
 private:
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// the generated normals of the obj and ply loaders: every position gets the sum of the normals of the triangles around it starting from
+// (1, 0, 0), normalized, so a position without triangles still gets a unit normal
+inline const glm::vec3 SMOOTH_NORMAL_START{1.0f, 0.0f, 0.0f};
+
+// the unit normal of the triangle, degenerate triangles get a zero normal so they don't add anything to the sums
+glm::vec3 GetTriangleNormal(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+// normalizes a sum, in the rare case that the normals cancel out it is the start again
+glm::vec3 FinishSmoothNormal(const glm::vec3& normal_sum);
+
+// triangle_positions has the 3 position indices of every triangle and triangle_normals the normal of every triangle, the sums are
+// reduced per position through a position to triangle adjacency (csr) in triangle order, so they don't depend on the thread count
+std::vector<glm::vec3> ComputeSmoothNormals(size_t position_count, const std::vector<unsigned int>& triangle_positions, const std::vector<glm::vec3>& triangle_normals);
\ No newline at end of file
@@ -9,7 +9,10 @@ public:
 
     void Resize(GLsizei width, GLsizei height);
     GLuint GetTextureID();
+    // binds it as an image
     void Bind(GLuint unit, GLenum access);
+    // binds it for sampling
+    void BindTexture(GLuint unit);
 
 private:
     GLuint m_texture_id;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    // the pool shared by the whole application, it has one worker less than the hardware threads because the caller of ParallelFor works too
+    static ThreadPool& Shared();
+
+    size_t GetThreadCount() const;
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> Submit(F&& task);
+
+    // calls function(begin, end) on consecutive chunks of [0, count), the calling thread processes chunks as well
+    // so it can be called from inside a pool task without the risk of a deadlock
+    template <typename F>
+    void ParallelFor(size_t count, size_t min_chunk_size, F&& function);
+
+private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+};
+
+template <typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::Submit(F&& task) {
+    using Result = std::invoke_result_t<F>;
+
+    // std::function needs a copyable callable so the packaged task is shared
+    auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged_task->get_future();
+    Enqueue([packaged_task]() { (*packaged_task)(); });
+    return result;
+}
+
+template <typename F>
+void ThreadPool::ParallelFor(size_t count, size_t min_chunk_size, F&& function) {
+    size_t max_chunk_count = (count + std::max(min_chunk_size, size_t{1}) - 1) / std::max(min_chunk_size, size_t{1});
+    size_t chunk_count = std::min(GetThreadCount() + 1, max_chunk_count);
+
+    if (chunk_count <= 1) {
+        if (count != 0) {
+            function(size_t{0}, count);
+        }
+        return;
+    }
+
+    size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+    struct State {
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> finished_chunks{0};
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+
+    // helpers that start after every chunk has been claimed return without touching the function, so capturing it by reference is fine
+    auto run_chunks = [state, &function, count, chunk_size, chunk_count]() {
+        for (size_t chunk = state->next_chunk++; chunk < chunk_count; chunk = state->next_chunk++) {
+            function(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+
+            if (++state->finished_chunks == chunk_count) {
+                std::lock_guard<std::mutex> lock{state->mutex};
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    for (size_t i = 1; i < chunk_count; i++) {
+        Enqueue(run_chunks);
+    }
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock{state->mutex};
+    state->condition.wait(lock, [&state, chunk_count]() { return state->finished_chunks == chunk_count; });
+}
\ No newline at end of file
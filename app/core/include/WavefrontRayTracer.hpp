@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <vector>
+
+#include "Buffer.hpp"
+#include "Shader.hpp"
+
+// the path tracing is split into passes (generate, extend, shade, miss) that communicate through ray queues in buffers,
+// so every pass only runs the code of one stage and the rays that are still alive stay packed together between the bounces
+class WavefrontRayTracer {
+public:
+    enum Stage { GENERATE, EXTEND, SHADE, MISS, STAGE_COUNT };
+
+    WavefrontRayTracer(GLsizei width, GLsizei height);
+    ~WavefrontRayTracer();
+
+    void Resize(GLsizei width, GLsizei height);
+    // the framebuffer has to be bound (the depth, the accumulation and the variance are the images 1-3), so do the scene buffers
+    // (0-3, 8-9), the convergence mask (10), the skybox and the frame uniforms
+    // every sample is traced by its own generate pass and bounces, so the queues only ever hold one ray per pixel
+    void Trace(GLuint max_recursion_limit, GLuint samples_per_pixel);
+
+    // the gpu time of every stage summed over the bounces, from the last frame whose timer queries finished
+    const std::array<float, STAGE_COUNT>& GetStageMilliseconds();
+
+private:
+    void DispatchIndirect(Stage stage, Shader& shader, Buffer& queue);
+    void BeginStageTimer(Stage stage);
+    void EndStageTimer();
+    void ReadStageTimes();
+
+    GLsizei m_width;
+    GLsizei m_height;
+
+    Shader m_generate_shader;
+    Shader m_extend_shader;
+    Shader m_shade_shader;
+    Shader m_miss_shader;
+
+    // they are swapped after every bounce, the outgoing rays of one are the incoming ones of the next
+    std::array<Buffer, 2> m_ray_queues;
+    Buffer m_hit_queue;
+    Buffer m_miss_queue;
+
+    // a pair of timestamps around every pass
+    std::vector<GLuint> m_timestamp_queries;
+    std::vector<Stage> m_query_stages;
+    size_t m_used_query_count = 0;
+    std::array<float, STAGE_COUNT> m_stage_milliseconds{};
+};
\ No newline at end of file
@@ -2,28 +2,163 @@
 
 #include "App.hpp"
 #include "SDL_GLDebugMessageCallback.h"
+#include "AssetCache.hpp"
+#include "MeshFile.hpp"
+#include "ThreadPool.hpp"
 
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+
+// if the obj was converted with mesh_converter the binary file next to it is loaded instead, it doesn't need any parsing
+// (unless the obj changed since then or the mesh file is from an other version of the format)
+std::filesystem::path PreferMeshFile(const std::filesystem::path& filename) {
+    std::filesystem::path mesh_filename = std::filesystem::path{filename}.replace_extension(MESH_FILE_EXTENSION);
+    std::error_code error;
+    std::filesystem::file_time_type mesh_write_time = std::filesystem::last_write_time(mesh_filename, error);
+    if (error) {
+        return filename;
+    }
+    std::filesystem::file_time_type obj_write_time = std::filesystem::last_write_time(filename, error);
+    if (!error && mesh_write_time < obj_write_time) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "[App] warning: %s is older than %s, the obj is loaded instead", mesh_filename.string().c_str(), filename.string().c_str());
+        return filename;
+    }
+    if (!IsCurrentMeshFile(mesh_filename)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "[App] warning: %s is not a version %u mesh file, the obj is loaded instead", mesh_filename.string().c_str(), MESH_FILE_VERSION);
+        return filename;
+    }
+    return mesh_filename;
+}
+
+struct SceneMeshDescription {
+    std::filesystem::path filename;
+    size_t material_id;
+    glm::mat4 transform;
+};
+
+// a scene of a single obj file at least this big is built by the streaming octree constructor, it is never parsed into memory as a whole
+constexpr std::uintmax_t STREAMED_BUILD_MIN_FILE_SIZE = std::uintmax_t{1} << 30;
+constexpr size_t STREAMED_BUILD_MAX_TRIANGLES_IN_MEMORY = 1 << 22;
+
+bool IsStreamedBuild(const std::vector<SceneMeshDescription>& descriptions) {
+    if (descriptions.size() != 1 || descriptions[0].filename.extension() != ".obj") {
+        return false;
+    }
+    std::error_code error;
+    std::uintmax_t file_size = std::filesystem::file_size(descriptions[0].filename, error);
+    return !error && file_size >= STREAMED_BUILD_MIN_FILE_SIZE;
+}
+
+std::vector<SceneMeshDescription> GetSceneMeshDescriptions() {
+    std::vector<SceneMeshDescription> descriptions{};
+    descriptions.push_back({PreferMeshFile("assets/xyzrgb_dragon.obj"), 1, glm::translate(glm::vec3(6.0, 2.0, -2.0)) * glm::scale(glm::vec3(0.02, 0.02, 0.02))});
+    // repeated files are only loaded once (see AssetCache)
+    //descriptions.push_back({"assets/suzanne.obj", 1, glm::translate(glm::vec3(20.0, 1.0, 5.0))});
+    //descriptions.push_back({"assets/suzanne.obj", 2, glm::translate(glm::vec3(30.0, 1.0, 5.0))});
+    //descriptions.push_back({"assets/stanford_bunny.obj", 1, glm::mat4{1.0f}});
+    return descriptions;
+}
 
+// runs on a worker thread
+std::unique_ptr<Octree> LoadSceneOctree(const std::vector<SceneMeshDescription>& descriptions, std::atomic<size_t>& loaded_mesh_count) {
+    if (IsStreamedBuild(descriptions)) {
+        const SceneMeshDescription& description = descriptions[0];
+        std::unique_ptr<Octree> octree = std::make_unique<Octree>(description.filename, description.material_id, description.transform, STREAMED_BUILD_MAX_TRIANGLES_IN_MEMORY, 18, 10, 6, 6);
+        loaded_mesh_count++;
+        return octree;
+    }
+
+    // the mesh data is shared through the asset cache, the octree places every instance while it merges them
+    std::vector<MeshInstance> instances{};
+    for (const SceneMeshDescription& description : descriptions) {
+        instances.push_back(MeshInstance{AssetCache::Shared().GetMesh(description.filename), description.material_id, description.transform});
+        loaded_mesh_count++;
+    }
+
+    return std::make_unique<Octree>(instances, 18, 10, 6, 6);
+}
+
+template <typename T>
+bool IsReady(const std::future<T>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+}
+
+template <typename T>
+size_t GetByteSize(const std::vector<T>& data) {
+    return data.size() * sizeof(T);
+}
+
+constexpr size_t OCTREE_UPLOAD_BYTES_PER_FRAME = 32 << 20;
+constexpr GLuint MAX_RECURSION_LIMIT = 5;
+constexpr int MAX_SAMPLES_PER_PIXEL = 16;
+// the last iteration has taps 2^(n-1) pixels apart
+constexpr int MAX_DENOISE_ITERATION_COUNT = 5;
+// the most samples a pixel keeps from before a camera move
+constexpr int MAX_HISTORY_LIMIT = 256;
+// the cpu can be this many frames ahead of the gpu before it has to wait for a free slot
+constexpr size_t FRAME_UNIFORM_SLOT_COUNT = 3;
+
+// a 32x32 workgroup is the largest every implementation has to support
+constexpr std::array<GLuint, 4> TILE_SIZES = {4, 8, 16, 32};
+constexpr const char* TILE_SIZE_NAMES[] = {"4", "8", "16", "32"};
+constexpr int DEFAULT_TILE_SIZE_INDEX = 1;
+
+std::unique_ptr<Shader> CreateComputeRayTracerShader(GLuint tile_size_x, GLuint tile_size_y) {
+    return std::make_unique<Shader>("assets/ray_tracer.comp", std::vector<std::string>{
+        "TILE_SIZE_X " + std::to_string(tile_size_x), 
+        "TILE_SIZE_Y " + std::to_string(tile_size_y)
+    });
+}
+
+template <typename T>
+bool UploadDirtyRanges(Buffer& buffer, const std::vector<T>& data, const std::vector<DirtyRange>& dirty_ranges) {
+    GLsizeiptr size = static_cast<GLsizeiptr>(data.size() * sizeof(T));
+    if (size > buffer.GetSize()) {
+        // it doesn't fit in the old storage, so the whole buffer is uploaded again
+        buffer.Resize(size, data.data());
+        return true;
+    }
+
+    for (const DirtyRange& range : dirty_ranges) {
+        buffer.Update(static_cast<GLintptr>(range.offset), static_cast<GLsizeiptr>(range.size), reinterpret_cast<const char*>(data.data()) + range.offset);
+    }
+    return !dirty_ranges.empty();
+}
 
 App::App(GLsizei width, GLsizei height) : 
     m_width{width}, 
     m_height{height}, 
+    m_render_width{width}, 
+    m_render_height{height}, 
     m_camera{}, 
     m_camera_manipulator{}, 
     m_framebuffer{width, height}, 
     m_ray_tracer_shader{"assets/ray_tracer.vert", "assets/ray_tracer.frag"},
     m_raster_shader{"assets/Vert_PosNormTex.vert", "assets/Frag_LightingSimple.frag"},
-    m_mesh_1{"assets/xyzrgb_dragon.obj", 1, glm::translate(glm::vec3(6.0, 2.0, -2.0)) * glm::scale(glm::vec3(0.02, 0.02, 0.02))},
-    m_mesh_2{"assets/suzanne.obj", 1, glm::translate(glm::vec3(20.0, 1.0, 5.0))},
-    m_mesh_3{"assets/suzanne.obj", 2, glm::translate(glm::vec3(30.0, 1.0, 5.0))},
-    //m_mesh_2{"assets/stanford_bunny.obj", 1},
-    //m_mesh_3{"assets/xyzrgb_dragon.obj", 2},
-    m_octree{std::vector<Mesh>{m_mesh_1}, 18, 10, 6, 6},
-    m_vertecies_buffer{static_cast<GLsizeiptr>(m_octree.m_vertecies.size() * sizeof(decltype(m_octree.m_vertecies)::value_type)), m_octree.m_vertecies.data()},
-    m_normal_buffer{static_cast<GLsizeiptr>(m_octree.m_normals.size() * sizeof(decltype(m_octree.m_normals)::value_type)), m_octree.m_normals.data()},
-    m_indecies_buffer{static_cast<GLsizeiptr>(m_octree.m_compressed_triangles.size() * sizeof(decltype(m_octree.m_compressed_triangles)::value_type)), m_octree.m_compressed_triangles.data()},
-    m_node_buffer{static_cast<GLsizeiptr>(m_octree.m_compressed_node_buffer.size() * sizeof(decltype(m_octree.m_compressed_node_buffer)::value_type)), m_octree.m_compressed_node_buffer.data()},
+    m_resolve_shader{"assets/ray_tracer.vert", "assets/resolve.frag"},
+    m_tile_size_x_index{DEFAULT_TILE_SIZE_INDEX},
+    m_tile_size_y_index{DEFAULT_TILE_SIZE_INDEX},
+    m_compute_ray_tracer_shader{CreateComputeRayTracerShader(TILE_SIZES[DEFAULT_TILE_SIZE_INDEX], TILE_SIZES[DEFAULT_TILE_SIZE_INDEX])},
+    m_wavefront_ray_tracer{width, height},
+    m_convergence_mask{width, height},
+    m_denoiser{width, height},
+    m_reprojection{width, height},
+    m_frame_uniforms{static_cast<GLsizeiptr>(sizeof(FrameUniforms)), FRAME_UNIFORM_SLOT_COUNT},
+    m_octree{std::make_unique<Octree>(std::vector<Mesh>{}, 18, 10, 6, 6)},
+    m_vertecies_buffer{static_cast<GLsizeiptr>(GetByteSize(m_octree->m_vertecies)), m_octree->m_vertecies.data(), GL_DYNAMIC_STORAGE_BIT},
+    m_normal_buffer{static_cast<GLsizeiptr>(GetByteSize(m_octree->m_normals)), m_octree->m_normals.data(), GL_DYNAMIC_STORAGE_BIT},
+    m_indecies_buffer{static_cast<GLsizeiptr>(GetByteSize(m_octree->m_compressed_triangles)), m_octree->m_compressed_triangles.data(), GL_DYNAMIC_STORAGE_BIT},
+    m_node_buffer{static_cast<GLsizeiptr>(GetByteSize(m_octree->m_compressed_node_buffer)), m_octree->m_compressed_node_buffer.data(), GL_DYNAMIC_STORAGE_BIT},
+    m_primitives{GetScenePrimitives()},
+    m_materials{GetSceneMaterials()},
+    m_primitive_buffer{static_cast<GLsizeiptr>(GetByteSize(m_primitives)), m_primitives.data(), GL_DYNAMIC_STORAGE_BIT},
+    m_material_buffer{static_cast<GLsizeiptr>(GetByteSize(m_materials)), m_materials.data(), GL_DYNAMIC_STORAGE_BIT},
     m_skybox{},
     m_time_in_seconds{0.0f},
     m_still_frame_counter{1},
@@ -45,9 +180,6 @@ App::App(GLsizei width, GLsizei height) :
 
     glGenVertexArrays(1, &m_empty_vao); 
 
-    glEnable(GL_BLEND); 
-    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
-
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
 
@@ -62,14 +194,19 @@ App::App(GLsizei width, GLsizei height) :
 
     m_camera_manipulator.SetCamera(&m_camera);
 
-    const std::initializer_list<VertexAttributeDescriptor> vertexAttribList = {
-		{ 0, offsetof(Vertex, position), 3, GL_FLOAT },
-		{ 1, offsetof(Vertex, normal),	 3, GL_FLOAT },
-		{ 2, offsetof(Vertex, texcoord), 2, GL_FLOAT },
-	};
+    // nothing big is loaded here so the first frame is rendered right away, the skybox stays black and the scene empty until the loads finish
+    // (the pool runs the tasks in this order, so the cheap ones show up first)
+    m_skybox_future = ThreadPool::Shared().Submit([]() { return Skybox::LoadFaces(); });
+    m_suzanne_future = ThreadPool::Shared().Submit([]() { return AssetCache::Shared().GetMeshObject("assets/suzanne.obj"); });
 
-	MeshObject<Vertex> suzanneMeshCPU = ObjParser::parse("assets/suzanne.obj");
-	m_Suzanne = CreateGLObjectFromMesh(suzanneMeshCPU, vertexAttribList);
+    std::vector<SceneMeshDescription> scene_mesh_descriptions = GetSceneMeshDescriptions();
+    m_scene_mesh_count = scene_mesh_descriptions.size();
+    m_is_streamed_scene = IsStreamedBuild(scene_mesh_descriptions);
+    m_loaded_scene_mesh_count = std::make_shared<std::atomic<size_t>>(0);
+    // the task only captures by value, so it can't outlive anything it uses
+    m_octree_future = ThreadPool::Shared().Submit([scene_mesh_descriptions, loaded_mesh_count = m_loaded_scene_mesh_count]() {
+        return LoadSceneOctree(scene_mesh_descriptions, *loaded_mesh_count);
+    });
 
     glGenTextures(1, &m_metalTextureID);
 	TextureFromFile(m_metalTextureID, "assets/metal.png");
@@ -86,63 +223,253 @@ App::~App() {
 
 void App::Update(float elapsed_time_in_seconds, float delta_time_in_seconds) {
     m_time_in_seconds = elapsed_time_in_seconds;
+    UpdateLoading();
     bool camera_changed = m_camera_manipulator.Update(delta_time_in_seconds, m_portal_1, m_portal_2, m_portal_width, m_portal_height);
-    if (camera_changed) {
+
+    if (m_wobble_last_inserted) {
+        // deforms the mesh every frame, the octree is refitted instead of rebuilt
+        std::vector<glm::vec4> vertecies = m_wobble_rest_vertecies;
+        for (glm::vec4& vertex : vertecies) {
+            vertex.x += 0.1f * std::sin(3.0f * m_time_in_seconds + 4.0f * vertex.y);
+        }
+        m_octree->Refit(m_inserted_meshes.back(), vertecies, {});
+    }
+
+    bool octree_changed = UploadOctreeChanges();
+    if (octree_changed) {
+        RestartAccumulation();
+    } else if (camera_changed) {
+        // the accumulation starts over from the reprojected samples
         m_still_frame_counter = 1;
     }
+
+    // the resolution only adapts while the camera moves, the accumulation of a still camera would be restarted by every change
+    if (camera_changed && m_is_dynamic_resolution_enabled && m_dynamic_resolution.UpdateScale(m_target_frame_milliseconds)) {
+        ResizeRenderTarget();
+    }
+}
+
+bool App::UploadOctreeChanges() {
+    OctreeDirtyRanges dirty_ranges = m_octree->TakeDirtyRanges();
+
+    // only the modified byte ranges are sent to the gpu
+    bool changed = false;
+    changed |= UploadDirtyRanges(m_vertecies_buffer, m_octree->m_vertecies, dirty_ranges.vertecies);
+    changed |= UploadDirtyRanges(m_normal_buffer, m_octree->m_normals, dirty_ranges.normals);
+    changed |= UploadDirtyRanges(m_indecies_buffer, m_octree->m_compressed_triangles, dirty_ranges.triangles);
+    changed |= UploadDirtyRanges(m_node_buffer, m_octree->m_compressed_node_buffer, dirty_ranges.nodes);
+    return changed;
+}
+
+void App::UpdateLoading() {
+    if (IsReady(m_skybox_future)) {
+        std::vector<SDL_Surface*> faces = m_skybox_future.get();
+        m_skybox.Upload(faces);
+        RestartAccumulation();
+    }
+
+    if (IsReady(m_suzanne_future)) {
+        const std::initializer_list<VertexAttributeDescriptor> vertexAttribList = {
+            { 0, offsetof(Vertex, position), 3, GL_FLOAT },
+            { 1, offsetof(Vertex, normal),	 3, GL_FLOAT },
+            { 2, offsetof(Vertex, texcoord), 2, GL_FLOAT },
+        };
+
+        m_suzanne_mesh_cpu = m_suzanne_future.get();
+        m_Suzanne = CreateGLObjectFromMesh(*m_suzanne_mesh_cpu, vertexAttribList);
+    }
+
+    if (IsReady(m_octree_future)) {
+        m_uploading_octree = m_octree_future.get();
+
+        // only the storage is allocated here, the current octree is empty so it never reads the buffers while they are being filled
+        m_vertecies_buffer.Resize(static_cast<GLsizeiptr>(GetByteSize(m_uploading_octree->m_vertecies)), nullptr);
+        m_normal_buffer.Resize(static_cast<GLsizeiptr>(GetByteSize(m_uploading_octree->m_normals)), nullptr);
+        m_indecies_buffer.Resize(static_cast<GLsizeiptr>(GetByteSize(m_uploading_octree->m_compressed_triangles)), nullptr);
+        m_node_buffer.Resize(static_cast<GLsizeiptr>(GetByteSize(m_uploading_octree->m_compressed_node_buffer)), nullptr);
+
+        m_uploaded_octree_bytes = 0;
+        m_octree_byte_count = GetByteSize(m_uploading_octree->m_vertecies) + GetByteSize(m_uploading_octree->m_normals) + 
+                              GetByteSize(m_uploading_octree->m_compressed_triangles) + GetByteSize(m_uploading_octree->m_compressed_node_buffer);
+    }
+
+    if (m_uploading_octree != nullptr && ContinueOctreeUpload()) {
+        m_octree = std::move(m_uploading_octree);
+        m_octree->TakeDirtyRanges(); // all of it is on the gpu already
+        RestartAccumulation();
+    }
+}
+
+bool App::ContinueOctreeUpload() {
+    struct Upload {
+        Buffer& buffer;
+        const char* data;
+        size_t size;
+    };
+
+    std::array<Upload, 4> uploads = {{
+        {m_vertecies_buffer, reinterpret_cast<const char*>(m_uploading_octree->m_vertecies.data()), GetByteSize(m_uploading_octree->m_vertecies)},
+        {m_normal_buffer, reinterpret_cast<const char*>(m_uploading_octree->m_normals.data()), GetByteSize(m_uploading_octree->m_normals)},
+        {m_indecies_buffer, reinterpret_cast<const char*>(m_uploading_octree->m_compressed_triangles.data()), GetByteSize(m_uploading_octree->m_compressed_triangles)},
+        {m_node_buffer, reinterpret_cast<const char*>(m_uploading_octree->m_compressed_node_buffer.data()), GetByteSize(m_uploading_octree->m_compressed_node_buffer)},
+    }};
+
+    // the buffers are filled one after the other with a fixed amount per frame, so a big scene doesn't stall a single frame
+    size_t remaining_budget = OCTREE_UPLOAD_BYTES_PER_FRAME;
+    size_t upload_start = 0;
+    for (Upload& upload : uploads) {
+        size_t upload_end = upload_start + upload.size;
+        if (remaining_budget > 0 && m_uploaded_octree_bytes < upload_end) {
+            size_t offset = m_uploaded_octree_bytes - upload_start;
+            size_t size = std::min(remaining_budget, upload.size - offset);
+            upload.buffer.Update(static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), upload.data + offset);
+
+            m_uploaded_octree_bytes += size;
+            remaining_budget -= size;
+        }
+        upload_start = upload_end;
+    }
+
+    return m_uploaded_octree_bytes == m_octree_byte_count;
+}
+
+void App::UploadPrimitive(size_t index) {
+    UploadDirtyRanges(m_primitive_buffer, m_primitives, {DirtyRange{index * sizeof(AnalyticPrimitive), sizeof(AnalyticPrimitive)}});
+    RestartAccumulation();
 }
 
+void App::UploadMaterial(size_t index) {
+    UploadDirtyRanges(m_material_buffer, m_materials, {DirtyRange{index * sizeof(Material), sizeof(Material)}});
+    RestartAccumulation();
+}
+
+void App::RestartAccumulation() {
+    m_still_frame_counter = 1;
+    m_is_history_valid = false;
+}
+
+void App::ResizeRenderTarget() {
+    float scale = m_is_dynamic_resolution_enabled ? m_dynamic_resolution.GetScale() : 1.0f;
+    m_render_width = std::max(static_cast<GLsizei>(static_cast<float>(m_width) * scale), GLsizei{1});
+    m_render_height = std::max(static_cast<GLsizei>(static_cast<float>(m_height) * scale), GLsizei{1});
+
+    m_framebuffer.Resize(m_render_width, m_render_height);
+    m_wavefront_ray_tracer.Resize(m_render_width, m_render_height);
+    m_convergence_mask.Resize(m_render_width, m_render_height);
+    m_denoiser.Resize(m_render_width, m_render_height);
+    m_reprojection.Resize(m_render_width, m_render_height);
+    RestartAccumulation();
+}
+
+bool App::IsSceneLoaded() {
+    return !m_skybox_future.valid() && !m_suzanne_future.valid() && !m_octree_future.valid() && m_uploading_octree == nullptr;
+}
+
+
+void App::WriteFrameUniforms() {
+    // the slot is write combined memory, so it is filled in one go instead of member by member
+    FrameUniforms frame_uniforms{};
+    frame_uniforms.inv_view_proj_mat = glm::inverse(m_camera.GetViewProj());
+    frame_uniforms.portal_1_to_2 = m_portal_1.GetDifferenceMatrixTo(m_portal_2);
+    frame_uniforms.portal_2_to_1 = m_portal_2.GetDifferenceMatrixTo(m_portal_1);
+    frame_uniforms.camera_position = m_camera.GetEye();
+    frame_uniforms.width = static_cast<GLfloat>(m_render_width);
+    frame_uniforms.octree_min_bounds = m_octree->GetMinBounds();
+    frame_uniforms.height = static_cast<GLfloat>(m_render_height);
+    frame_uniforms.octree_max_bounds = m_octree->GetMaxBounds();
+    frame_uniforms.max_recursion_limit = MAX_RECURSION_LIMIT;
+    frame_uniforms.portal_position_1 = m_portal_1.GetPosition();
+    frame_uniforms.time = static_cast<GLfloat>(m_time_in_seconds);
+    frame_uniforms.portal_direction_1 = m_portal_1.GetDirection();
+    frame_uniforms.blur_amount = static_cast<GLfloat>(0.00001);
+    frame_uniforms.portal_position_2 = m_portal_2.GetPosition();
+    frame_uniforms.portal_width = static_cast<GLfloat>(m_portal_width);
+    frame_uniforms.portal_direction_2 = m_portal_2.GetDirection();
+    frame_uniforms.portal_height = static_cast<GLfloat>(m_portal_height);
+    frame_uniforms.z_near = static_cast<GLfloat>(m_camera.GetZNear());
+    frame_uniforms.z_far = static_cast<GLfloat>(m_camera.GetZFar());
+    frame_uniforms.samples_per_pixel = static_cast<GLuint>(m_samples_per_pixel);
+    frame_uniforms.accumulated_frame_count = static_cast<GLuint>(m_still_frame_counter - 1);
+
+    std::memcpy(m_frame_uniforms.MapNextSlot(), &frame_uniforms, sizeof(FrameUniforms));
+    m_frame_uniforms.BindUniform(0);
+}
 
 void App::Render() {
+    m_dynamic_resolution.BeginFrame();
     m_framebuffer.Bind();
+    glViewport(0, 0, m_render_width, m_render_height);
     glClear(GL_DEPTH_BUFFER_BIT);
 
     //glDisable(GL_DEPTH_TEST);
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND); 
-    //glDisable(GL_BLEND); 
-    glBlendColor(0.0f, 0.0f, 0.0f, 1.0f / static_cast<float>(m_still_frame_counter));
+    WriteFrameUniforms();
+    bool is_restart = (m_still_frame_counter == 1);
+    bool is_reprojected = is_restart && m_reproject && m_is_history_valid;
     m_still_frame_counter++;
     
-    m_ray_tracer_shader.Use();
-    
-    glBindVertexArray(m_empty_vao); 
-    
     m_vertecies_buffer.Bind(0);
     m_normal_buffer.Bind(1);
     m_indecies_buffer.Bind(2);
     m_node_buffer.Bind(3);
+    m_primitive_buffer.Bind(8);
+    m_material_buffer.Bind(9);
+    m_convergence_mask.Bind(10);
     
     glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skybox.GetTextureID());
-    glUniform1i(m_ray_tracer_shader.ul("skyboxTexture"), 0);
-    
-    glUniformMatrix4fv(m_ray_tracer_shader.ul("inv_view_proj_mat"), 1, GL_FALSE, glm::value_ptr(glm::inverse(m_camera.GetViewProj())));
-    glUniform3fv(m_ray_tracer_shader.ul("camera_position"), 1, glm::value_ptr(m_camera.GetEye()));
-    glUniform1f(m_ray_tracer_shader.ul("width"), static_cast<GLfloat>(m_width));
-    glUniform1f(m_ray_tracer_shader.ul("height"), static_cast<GLfloat>(m_height));
-    glUniform3fv(m_ray_tracer_shader.ul("octree_min_bounds"), 1, glm::value_ptr(m_octree.GetMinBounds()));
-    glUniform3fv(m_ray_tracer_shader.ul("octree_max_bounds"), 1, glm::value_ptr(m_octree.GetMaxBounds()));
-    glUniform1ui(m_ray_tracer_shader.ul("max_recursion_limit"), static_cast<GLuint>(5));
-    glUniform1f(m_ray_tracer_shader.ul("time"), static_cast<GLfloat>(m_time_in_seconds));
-    glUniform1f(m_ray_tracer_shader.ul("blur_amount"), static_cast<GLfloat>(0.00001));
-    glUniform3fv(m_ray_tracer_shader.ul("portal_position_1"), 1, glm::value_ptr(m_portal_1.GetPosition()));
-    glUniform3fv(m_ray_tracer_shader.ul("portal_direction_1"), 1, glm::value_ptr(m_portal_1.GetDirection()));
-    glUniform3fv(m_ray_tracer_shader.ul("portal_position_2"), 1, glm::value_ptr(m_portal_2.GetPosition()));
-    glUniform3fv(m_ray_tracer_shader.ul("portal_direction_2"), 1, glm::value_ptr(m_portal_2.GetDirection()));
-    glUniform1f(m_ray_tracer_shader.ul("portal_width"), static_cast<GLfloat>(m_portal_width));
-    glUniform1f(m_ray_tracer_shader.ul("portal_height"), static_cast<GLfloat>(m_portal_height));
-    glUniformMatrix4fv(m_ray_tracer_shader.ul("portal_1_to_2"), 1, GL_FALSE, glm::value_ptr(m_portal_1.GetDifferenceMatrixTo(m_portal_2)));
-    glUniformMatrix4fv(m_ray_tracer_shader.ul("portal_2_to_1"), 1, GL_FALSE, glm::value_ptr(m_portal_2.GetDifferenceMatrixTo(m_portal_1)));
-    glUniform1f(m_ray_tracer_shader.ul("z_near"), static_cast<GLfloat>(m_camera.GetZNear()));
-    glUniform1f(m_ray_tracer_shader.ul("z_far"), static_cast<GLfloat>(m_camera.GetZFar()));
-    
+
+    glBindVertexArray(m_empty_vao); 
+
+    // the restarted frame overwrites the accumulation
+    if (is_reprojected) {
+        m_reprojection.SaveHistory(m_framebuffer);
+    }
+
+    // every ray tracer adds its samples to the accumulation image (and writes the depth image), the resolve pass below tone maps
+    // the average into the target
+    // once every tile converged nothing is traced, the accumulation doesn't change until it restarts
+    if (is_restart || !m_convergence_mask.IsConverged()) {
+        if (m_ray_tracer_mode == RayTracerMode::COMPUTE) {
+            // the framebuffer has the images bound, one invocation traces one pixel
+            m_compute_ray_tracer_shader->Use();
+
+            GLuint tile_size_x = TILE_SIZES[m_tile_size_x_index];
+            GLuint tile_size_y = TILE_SIZES[m_tile_size_y_index];
+            glDispatchCompute((static_cast<GLuint>(m_render_width) + tile_size_x - 1) / tile_size_x, (static_cast<GLuint>(m_render_height) + tile_size_y - 1) / tile_size_y, 1);
+        } else if (m_ray_tracer_mode == RayTracerMode::WAVEFRONT) {
+            m_wavefront_ray_tracer.Trace(MAX_RECURSION_LIMIT, static_cast<GLuint>(m_samples_per_pixel));
+        } else {
+            // one fragment traces one pixel, it only writes the images
+            m_ray_tracer_shader.Use();
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthMask(GL_FALSE);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glDepthMask(GL_TRUE);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        }
+    }
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    if (is_reprojected) {
+        m_reprojection.Reproject(m_previous_view_proj, m_previous_camera_position, static_cast<GLuint>(m_history_limit));
+    }
+
+    // it runs even when nothing was traced, the target error can change
+    m_convergence_mask.Update(m_adaptive_sampling ? m_target_error : 0.0f, is_restart);
+
+    if (m_denoise) {
+        m_denoiser.Denoise(m_denoise_iteration_count);
+    }
+
+    // the depth is written too so the rasterized objects are hidden behind the traced scene
+    m_resolve_shader.Use();
+    glUniform1i(m_resolve_shader.ul("is_denoised"), m_denoise ? GL_TRUE : GL_FALSE);
+    glDepthFunc(GL_ALWAYS);
     glDrawArrays(GL_TRIANGLES, 0, 3);
-    
-    glDisable(GL_BLEND); 
+    glDepthFunc(GL_LEQUAL);
 
     glEnable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
 
     m_raster_shader.Use();
 
@@ -159,13 +486,16 @@ void App::Render() {
 	glUniform3fv(m_raster_shader.ul("La"), 1, glm::value_ptr(m_La));
 	glUniform3fv(m_raster_shader.ul("Ld"), 1, glm::value_ptr(m_Ld));
 
-    for (int i = -1; i <= 1; ++i) {
-		for (int j = -1; j <= 1; ++j) {
-			glm::mat4 suzanneWorld = glm::translate(glm::vec3(4.0 * i, 4.0 + 4.0 * j, 0.0));
-			glUniformMatrix4fv(m_raster_shader.ul("world"), 1, GL_FALSE, glm::value_ptr(suzanneWorld));
-			glUniformMatrix4fv(m_raster_shader.ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(suzanneWorld))));
-			glDrawElements(GL_TRIANGLES, m_Suzanne.count, GL_UNSIGNED_INT, 0);
-		}
+    // the vao is only created once suzanne is loaded
+    if (m_Suzanne.vaoID != 0) {
+        for (int i = -1; i <= 1; ++i) {
+            for (int j = -1; j <= 1; ++j) {
+                glm::mat4 suzanneWorld = glm::translate(glm::vec3(4.0 * i, 4.0 + 4.0 * j, 0.0));
+                glUniformMatrix4fv(m_raster_shader.ul("world"), 1, GL_FALSE, glm::value_ptr(suzanneWorld));
+                glUniformMatrix4fv(m_raster_shader.ul("worldIT"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(suzanneWorld))));
+                glDrawElements(GL_TRIANGLES, m_Suzanne.count, GL_UNSIGNED_INT, 0);
+            }
+        }
     }
 
     glUseProgram(0);
@@ -174,13 +504,156 @@ void App::Render() {
     m_framebuffer.UnBind();
 
 
-    m_framebuffer.Blit();
+    m_framebuffer.Blit(m_width, m_height);
+    m_frame_uniforms.FenceCurrentSlot();
+    m_dynamic_resolution.EndFrame();
+
+    m_previous_view_proj = m_camera.GetViewProj();
+    m_previous_camera_position = m_camera.GetEye();
+    m_is_history_valid = true;
 }
 
 void App::RenderImGui() {
     ImGui::ShowDemoWindow();
-    //if (ImGui::Begin("Settings")) {
-    //}
+    if (ImGui::Begin("Settings")) {
+        if (!IsSceneLoaded()) {
+            // the octree can't be edited before the loaded one is swapped in
+            size_t loaded_mesh_count = *m_loaded_scene_mesh_count;
+            char overlay[64];
+
+            ImGui::Text("Loading scene");
+            ImGui::BulletText("skybox: %s", m_skybox_future.valid() ? "loading" : "done");
+            ImGui::BulletText("suzanne: %s", m_suzanne_future.valid() ? "loading" : "done");
+            ImGui::BulletText("octree: %s", m_octree_future.valid() ? ((loaded_mesh_count < m_scene_mesh_count) ? "loading meshes" : "building") : (m_uploading_octree != nullptr ? "uploading" : "done"));
+
+            std::snprintf(overlay, sizeof(overlay), "meshes %zu/%zu", loaded_mesh_count, m_scene_mesh_count);
+            ImGui::ProgressBar(static_cast<float>(loaded_mesh_count) / static_cast<float>(std::max(m_scene_mesh_count, size_t{1})), ImVec2{-1.0f, 0.0f}, overlay);
+
+            float upload_fraction = (m_octree_byte_count == 0) ? 0.0f : static_cast<float>(m_uploaded_octree_bytes) / static_cast<float>(m_octree_byte_count);
+            std::snprintf(overlay, sizeof(overlay), "upload %zu/%zu MB", m_uploaded_octree_bytes >> 20, m_octree_byte_count >> 20);
+            ImGui::ProgressBar(upload_fraction, ImVec2{-1.0f, 0.0f}, overlay);
+        } else {
+            ImGui::BeginDisabled(m_is_streamed_scene);
+            if (ImGui::Button("Insert suzanne")) {
+                MeshHandle handle = m_octree->Insert(Mesh{*m_suzanne_mesh_cpu, 2, glm::mat4{1.0f}}, glm::translate(m_camera.GetAt()));
+                if (handle != INVALID_MESH_HANDLE) {
+                    m_inserted_meshes.push_back(handle);
+                    m_wobble_last_inserted = false;
+                }
+            }
+            ImGui::EndDisabled();
+            if (m_is_streamed_scene) {
+                ImGui::TextDisabled("streamed scenes can't be edited");
+            }
+        }
+        if (!m_inserted_meshes.empty()) {
+            if (ImGui::Button("Move last inserted")) {
+                m_octree->Update(m_inserted_meshes.back(), glm::translate(glm::vec3{0.0f, 0.5f, 0.0f}));
+                m_wobble_last_inserted = false;
+            }
+            if (ImGui::Checkbox("Wobble last inserted", &m_wobble_last_inserted) && m_wobble_last_inserted) {
+                m_wobble_rest_vertecies = m_octree->GetMeshVertecies(m_inserted_meshes.back());
+                m_wobble_last_inserted = !m_wobble_rest_vertecies.empty();
+            }
+            if (ImGui::Button("Remove last inserted")) {
+                m_octree->Remove(m_inserted_meshes.back());
+                m_inserted_meshes.pop_back();
+                m_wobble_last_inserted = false;
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Primitives")) {
+            ImGui::SliderInt("Primitive", &m_selected_primitive, 0, static_cast<int>(m_primitives.size()) - 1);
+            if (!m_primitives.empty()) {
+                AnalyticPrimitive& primitive = m_primitives[m_selected_primitive];
+                int material_id = static_cast<int>(primitive.material_id);
+
+                bool primitive_changed = ImGui::DragFloat3("Position", glm::value_ptr(primitive.position), 0.01f);
+                if (primitive.type == PRIMITIVE_CYLINDER) {
+                    primitive_changed |= ImGui::DragFloat3("End position", glm::value_ptr(primitive.end_position), 0.01f);
+                }
+                primitive_changed |= ImGui::DragFloat("Radius", &primitive.radius, 0.01f, 0.001f, 1000.0f);
+                if (ImGui::SliderInt("Material", &material_id, 0, static_cast<int>(m_materials.size()) - 1)) {
+                    primitive.material_id = static_cast<GLuint>(material_id);
+                    primitive_changed = true;
+                }
+
+                if (primitive_changed) {
+                    UploadPrimitive(static_cast<size_t>(m_selected_primitive));
+                }
+            }
+            if (ImGui::Button("Add sphere")) {
+                m_primitives.push_back(MakeSphere(m_camera.GetAt(), 0.5f, 0));
+                m_selected_primitive = static_cast<int>(m_primitives.size()) - 1;
+                UploadPrimitive(m_primitives.size() - 1);
+            }
+        }
+        if (ImGui::CollapsingHeader("Materials")) {
+            ImGui::SliderInt("Material##edited", &m_selected_material, 0, static_cast<int>(m_materials.size()) - 1);
+            Material& material = m_materials[m_selected_material];
+
+            bool material_changed = ImGui::ColorEdit3("Color", glm::value_ptr(material.color));
+            material_changed |= ImGui::SliderFloat("Roughness", &material.roughness, 0.0f, 1.0f);
+            if (material.type == MATERIAL_DIELECTRIC) {
+                material_changed |= ImGui::SliderFloat("Refractive index", &material.refractive_index, 1.0f, 3.0f);
+            }
+
+            if (material_changed) {
+                UploadMaterial(static_cast<size_t>(m_selected_material));
+            }
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Ray tracer");
+        if (ImGui::RadioButton("Fragment", m_ray_tracer_mode == RayTracerMode::FRAGMENT)) {
+            m_ray_tracer_mode = RayTracerMode::FRAGMENT;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Compute", m_ray_tracer_mode == RayTracerMode::COMPUTE)) {
+            m_ray_tracer_mode = RayTracerMode::COMPUTE;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Wavefront", m_ray_tracer_mode == RayTracerMode::WAVEFRONT)) {
+            m_ray_tracer_mode = RayTracerMode::WAVEFRONT;
+        }
+
+        if (m_ray_tracer_mode == RayTracerMode::COMPUTE) {
+            bool tile_size_changed = ImGui::Combo("Tile width", &m_tile_size_x_index, TILE_SIZE_NAMES, static_cast<int>(TILE_SIZES.size()));
+            tile_size_changed |= ImGui::Combo("Tile height", &m_tile_size_y_index, TILE_SIZE_NAMES, static_cast<int>(TILE_SIZES.size()));
+            if (tile_size_changed) {
+                m_compute_ray_tracer_shader = CreateComputeRayTracerShader(TILE_SIZES[m_tile_size_x_index], TILE_SIZES[m_tile_size_y_index]);
+            }
+        } else if (m_ray_tracer_mode == RayTracerMode::WAVEFRONT) {
+            const std::array<float, WavefrontRayTracer::STAGE_COUNT>& stage_milliseconds = m_wavefront_ray_tracer.GetStageMilliseconds();
+            ImGui::BulletText("generate: %.2f ms", stage_milliseconds[WavefrontRayTracer::GENERATE]);
+            ImGui::BulletText("extend: %.2f ms", stage_milliseconds[WavefrontRayTracer::EXTEND]);
+            ImGui::BulletText("shade: %.2f ms", stage_milliseconds[WavefrontRayTracer::SHADE]);
+            ImGui::BulletText("miss: %.2f ms", stage_milliseconds[WavefrontRayTracer::MISS]);
+        }
+
+        ImGui::SliderInt("Samples per pixel", &m_samples_per_pixel, 1, MAX_SAMPLES_PER_PIXEL);
+        ImGui::Checkbox("Adaptive sampling", &m_adaptive_sampling);
+        if (m_adaptive_sampling) {
+            ImGui::SliderFloat("Target error", &m_target_error, 0.001f, 0.1f, "%.3f");
+            ImGui::Text("Tiles still sampled: %u/%u", m_convergence_mask.GetActiveTileCount(), m_convergence_mask.GetTileCount());
+        }
+        if (ImGui::Checkbox("Dynamic resolution", &m_is_dynamic_resolution_enabled)) {
+            ResizeRenderTarget();
+        }
+        if (m_is_dynamic_resolution_enabled) {
+            ImGui::SliderFloat("Target frame time (ms)", &m_target_frame_milliseconds, 4.0f, 100.0f, "%.1f");
+        }
+        ImGui::Text("Render resolution: %dx%d, gpu %.2f ms", m_render_width, m_render_height, m_dynamic_resolution.GetFrameMilliseconds());
+
+        ImGui::Checkbox("Reproject on camera move", &m_reproject);
+        if (m_reproject) {
+            ImGui::SliderInt("History limit", &m_history_limit, 1, MAX_HISTORY_LIMIT);
+        }
+        ImGui::Checkbox("Denoise", &m_denoise);
+        if (m_denoise) {
+            ImGui::SliderInt("Denoise iterations", &m_denoise_iteration_count, 1, MAX_DENOISE_ITERATION_COUNT);
+        }
+    }
     ImGui::End();
 }
 
@@ -203,8 +676,6 @@ void App::MouseWheel(const SDL_MouseWheelEvent& wheel) {
 void App::Resize(GLsizei width, GLsizei height) {
     m_width = width;
     m_height = height;
-    glViewport(0, 0, width, height);
-    m_framebuffer.Resize(width, height);
     m_camera.SetAspect(static_cast<float>(width) / static_cast<float>(height));
-    m_still_frame_counter = 1;
+    ResizeRenderTarget();
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "AssetCache.hpp"
+
+#include "ObjParser.hpp"
+
+#include <SDL2/SDL.h>
+
+AssetCache& AssetCache::Shared() {
+    static AssetCache asset_cache{};
+    return asset_cache;
+}
+
+std::shared_ptr<const Mesh> AssetCache::GetMesh(const std::filesystem::path& filename) {
+    return GetOrLoad(m_meshes, filename, [&filename]() {
+        return std::make_shared<const Mesh>(filename, 0, glm::mat4{1.0f});
+    });
+}
+
+std::shared_ptr<const MeshObject<Vertex>> AssetCache::GetMeshObject(const std::filesystem::path& filename) {
+    return GetOrLoad(m_mesh_objects, filename, [&filename]() {
+        try {
+            return std::make_shared<const MeshObject<Vertex>>(ObjParser::parse(filename));
+        } catch (ObjParser::Exception) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[AssetCache] error: couldn't open %s", filename.string().c_str());
+            exit(1);
+        }
+    });
+}
+
+AssetCache::Key AssetCache::GetKey(const std::filesystem::path& filename) {
+    std::error_code error;
+    std::filesystem::path canonical_filename = std::filesystem::canonical(filename, error);
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[AssetCache] error: couldn't find %s", filename.string().c_str());
+        exit(1);
+    }
+
+    std::filesystem::file_time_type write_time = std::filesystem::last_write_time(canonical_filename, error);
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[AssetCache] error: couldn't read the modification time of %s", filename.string().c_str());
+        exit(1);
+    }
+
+    return Key{canonical_filename.string(), write_time};
+}
+
+template <typename T, typename F>
+std::shared_ptr<const T> AssetCache::GetOrLoad(std::map<Key, std::weak_ptr<const T>>& entries, const std::filesystem::path& filename, F&& load) {
+    Key key = GetKey(filename);
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (std::shared_ptr<const T> asset = entries[key].lock()) {
+            return asset;
+        }
+    }
+
+    // the lock isn't held while loading so other assets can load in parallel, if the same file was loaded
+    // by someone else in the meantime their copy is used and this one is dropped
+    std::shared_ptr<const T> loaded_asset = load();
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    std::weak_ptr<const T>& entry = entries[key];
+    if (std::shared_ptr<const T> asset = entry.lock()) {
+        return asset;
+    }
+
+    // expired entries of other files are dropped here so the map doesn't grow with every file that was ever loaded
+    for (auto it = entries.begin(); it != entries.end();) {
+        it = (it->second.expired() && it->first != key) ? entries.erase(it) : std::next(it);
+    }
+
+    entry = loaded_asset;
+    return loaded_asset;
+}
\ No newline at end of file
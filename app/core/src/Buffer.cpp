@@ -1,8 +1,11 @@
 #include "Buffer.hpp"
 
-Buffer::Buffer(GLsizeiptr size, const void* data) {
+#include <algorithm>
+
+Buffer::Buffer(GLsizeiptr size, const void* data, GLbitfield flags) : m_size{size}, m_flags{flags} {
     glCreateBuffers(1, &m_buffer_id);
-    glNamedBufferStorage(m_buffer_id, size, data, 0);
+    // a zero sized storage is an error, but an empty buffer still has to be bindable (the scene is empty while it is loading)
+    glNamedBufferStorage(m_buffer_id, std::max(size, GLsizeiptr{1}), (size > 0) ? data : nullptr, flags);
 }
 
 Buffer::~Buffer() {
@@ -11,4 +14,24 @@ Buffer::~Buffer() {
 
 void Buffer::Bind(GLuint index) {
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, m_buffer_id);
+}
+
+void Buffer::Update(GLintptr offset, GLsizeiptr size, const void* data) {
+    glNamedBufferSubData(m_buffer_id, offset, size, data);
+}
+
+void Buffer::Resize(GLsizeiptr size, const void* data) {
+    glDeleteBuffers(1, &m_buffer_id);
+
+    glCreateBuffers(1, &m_buffer_id);
+    glNamedBufferStorage(m_buffer_id, std::max(size, GLsizeiptr{1}), (size > 0) ? data : nullptr, m_flags);
+    m_size = size;
+}
+
+GLsizeiptr Buffer::GetSize() {
+    return m_size;
+}
+
+GLuint Buffer::GetBufferID() {
+    return m_buffer_id;
 }
\ No newline at end of file
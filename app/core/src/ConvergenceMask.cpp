@@ -0,0 +1,103 @@
+#include "ConvergenceMask.hpp"
+
+// has to match ray_tracer.glsl
+constexpr GLuint CONVERGENCE_TILE_SIZE = 8;
+constexpr GLsizeiptr MASK_HEADER_SIZE = 4 * sizeof(GLuint);
+
+constexpr GLuint EMPTY_MASK_HEADER[4] = {0, 0, 0, 0};
+
+GLuint GetTileCountAlong(GLsizei size) {
+    return (static_cast<GLuint>(size) + CONVERGENCE_TILE_SIZE - 1) / CONVERGENCE_TILE_SIZE;
+}
+
+GLsizeiptr GetMaskSize(GLsizei width, GLsizei height) {
+    return MASK_HEADER_SIZE + static_cast<GLsizeiptr>(GetTileCountAlong(width)) * GetTileCountAlong(height) * static_cast<GLsizeiptr>(sizeof(GLuint));
+}
+
+ConvergenceMask::ConvergenceMask(GLsizei width, GLsizei height) :
+    m_tile_count_x{GetTileCountAlong(width)},
+    m_tile_count_y{GetTileCountAlong(height)},
+    m_convergence_shader{"assets/convergence.comp"},
+    m_mask_buffer{GetMaskSize(width, height), nullptr, GL_DYNAMIC_STORAGE_BIT},
+    m_readback_buffer{MASK_HEADER_SIZE, nullptr},
+    m_active_tile_count{m_tile_count_x * m_tile_count_y}
+{
+}
+
+ConvergenceMask::~ConvergenceMask() {
+    DropReadback();
+}
+
+void ConvergenceMask::Resize(GLsizei width, GLsizei height) {
+    m_tile_count_x = GetTileCountAlong(width);
+    m_tile_count_y = GetTileCountAlong(height);
+    m_mask_buffer.Resize(GetMaskSize(width, height), nullptr);
+
+    DropReadback();
+    m_active_tile_count = GetTileCount();
+}
+
+void ConvergenceMask::Update(float target_error, bool is_restart) {
+    if (is_restart) {
+        DropReadback();
+        m_active_tile_count = GetTileCount();
+    } else {
+        ReadActiveTileCount();
+    }
+
+    // the ray tracers have to be done with the mask and with the accumulation
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    m_mask_buffer.Update(0, MASK_HEADER_SIZE, EMPTY_MASK_HEADER);
+
+    m_mask_buffer.Bind(10);
+    m_convergence_shader.Use();
+    glUniform1f(m_convergence_shader.ul("target_error"), target_error);
+    glDispatchCompute(m_tile_count_x, m_tile_count_y, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // only one readback is in flight, the ones in between are skipped
+    if (m_readback_fence == nullptr) {
+        glCopyNamedBufferSubData(m_mask_buffer.GetBufferID(), m_readback_buffer.GetBufferID(), 0, 0, MASK_HEADER_SIZE);
+        m_readback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void ConvergenceMask::Bind(GLuint index) {
+    m_mask_buffer.Bind(index);
+}
+
+GLuint ConvergenceMask::GetActiveTileCount() {
+    return m_active_tile_count;
+}
+
+GLuint ConvergenceMask::GetTileCount() {
+    return m_tile_count_x * m_tile_count_y;
+}
+
+bool ConvergenceMask::IsConverged() {
+    return m_active_tile_count == 0;
+}
+
+void ConvergenceMask::ReadActiveTileCount() {
+    if (m_readback_fence == nullptr) {
+        return;
+    }
+
+    GLenum status = glClientWaitSync(m_readback_fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return;
+    }
+
+    GLuint header[4];
+    glGetNamedBufferSubData(m_readback_buffer.GetBufferID(), 0, MASK_HEADER_SIZE, header);
+    m_active_tile_count = header[0];
+    DropReadback();
+}
+
+void ConvergenceMask::DropReadback() {
+    if (m_readback_fence != nullptr) {
+        glDeleteSync(m_readback_fence);
+        m_readback_fence = nullptr;
+    }
+}
\ No newline at end of file
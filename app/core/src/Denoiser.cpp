@@ -0,0 +1,42 @@
+#include "Denoiser.hpp"
+
+// has to match denoise.comp
+constexpr GLuint DENOISE_TILE_SIZE = 8;
+
+Denoiser::Denoiser(GLsizei width, GLsizei height) :
+    m_width{width},
+    m_height{height},
+    m_denoise_shader{"assets/denoise.comp"},
+    m_illumination_textures{
+        Texture2D{width, height, GL_RGBA32F},
+        Texture2D{width, height, GL_RGBA32F}
+    }
+{
+}
+
+void Denoiser::Resize(GLsizei width, GLsizei height) {
+    m_width = width;
+    m_height = height;
+
+    m_illumination_textures[0].Resize(width, height);
+    m_illumination_textures[1].Resize(width, height);
+}
+
+void Denoiser::Denoise(int iteration_count) {
+    m_denoise_shader.Use();
+
+    for (int iteration = 0; iteration < iteration_count; iteration++) {
+        // the first iteration reads the accumulation instead, the input is only bound so every image is valid
+        m_illumination_textures[(iteration + 1) % 2].Bind(6, GL_READ_ONLY);
+        m_illumination_textures[iteration % 2].Bind(7, GL_WRITE_ONLY);
+
+        glUniform1i(m_denoise_shader.ul("step_size"), 1 << iteration);
+        glUniform1i(m_denoise_shader.ul("is_first_iteration"), (iteration == 0) ? GL_TRUE : GL_FALSE);
+        glUniform1i(m_denoise_shader.ul("is_last_iteration"), (iteration == iteration_count - 1) ? GL_TRUE : GL_FALSE);
+
+        glDispatchCompute((static_cast<GLuint>(m_width) + DENOISE_TILE_SIZE - 1) / DENOISE_TILE_SIZE, (static_cast<GLuint>(m_height) + DENOISE_TILE_SIZE - 1) / DENOISE_TILE_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    m_illumination_textures[(iteration_count + 1) % 2].Bind(6, GL_READ_ONLY);
+}
\ No newline at end of file
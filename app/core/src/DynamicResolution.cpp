@@ -0,0 +1,79 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float SCALE_STEP = 1.0f / 16.0f;
+// the scale only goes up if the next step is predicted to stay this much under the target, so it doesn't flip between two steps
+constexpr float SCALE_UP_HEADROOM = 0.9f;
+
+DynamicResolution::DynamicResolution() {
+    glGenQueries(static_cast<GLsizei>(m_timestamp_queries.size()), m_timestamp_queries.data());
+}
+
+DynamicResolution::~DynamicResolution() {
+    glDeleteQueries(static_cast<GLsizei>(m_timestamp_queries.size()), m_timestamp_queries.data());
+}
+
+void DynamicResolution::BeginFrame() {
+    m_current_frame = (m_current_frame + 1) % QUERY_FRAME_COUNT;
+
+    // the queries of this slot were issued QUERY_FRAME_COUNT frames ago, if they still aren't done that frame isn't measured
+    if (m_is_query_pending[m_current_frame]) {
+        GLint is_available = GL_FALSE;
+        glGetQueryObjectiv(m_timestamp_queries[2 * m_current_frame + 1], GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (is_available == GL_TRUE && m_query_scales[m_current_frame] == m_scale) {
+            GLuint64 start_time;
+            GLuint64 end_time;
+            glGetQueryObjectui64v(m_timestamp_queries[2 * m_current_frame], GL_QUERY_RESULT, &start_time);
+            glGetQueryObjectui64v(m_timestamp_queries[2 * m_current_frame + 1], GL_QUERY_RESULT, &end_time);
+            m_frame_milliseconds = static_cast<float>(end_time - start_time) / 1000000.0f;
+            m_has_new_measurement = true;
+        }
+    }
+
+    m_query_scales[m_current_frame] = m_scale;
+    glQueryCounter(m_timestamp_queries[2 * m_current_frame], GL_TIMESTAMP);
+}
+
+void DynamicResolution::EndFrame() {
+    glQueryCounter(m_timestamp_queries[2 * m_current_frame + 1], GL_TIMESTAMP);
+    m_is_query_pending[m_current_frame] = true;
+}
+
+bool DynamicResolution::UpdateScale(float target_milliseconds) {
+    if (!m_has_new_measurement || m_frame_milliseconds <= 0.0f) {
+        return false;
+    }
+    m_has_new_measurement = false;
+
+    // the gpu time is about proportional to the pixel count, so to the square of the scale
+    float new_scale = m_scale;
+    float next_scale = m_scale + SCALE_STEP;
+    if (m_frame_milliseconds > target_milliseconds) {
+        float ideal_scale = m_scale * std::sqrt(target_milliseconds / m_frame_milliseconds);
+        new_scale = std::floor(ideal_scale / SCALE_STEP) * SCALE_STEP;
+    } else if (m_frame_milliseconds * (next_scale * next_scale) / (m_scale * m_scale) < SCALE_UP_HEADROOM * target_milliseconds) {
+        new_scale = next_scale;
+    }
+    new_scale = std::clamp(new_scale, MIN_SCALE, MAX_SCALE);
+
+    if (new_scale == m_scale) {
+        return false;
+    }
+    m_scale = new_scale;
+    return true;
+}
+
+void DynamicResolution::SetScale(float scale) {
+    m_scale = std::clamp(scale, MIN_SCALE, MAX_SCALE);
+    m_has_new_measurement = false;
+}
+
+float DynamicResolution::GetScale() {
+    return m_scale;
+}
+
+float DynamicResolution::GetFrameMilliseconds() {
+    return m_frame_milliseconds;
+}
\ No newline at end of file
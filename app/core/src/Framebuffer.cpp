@@ -3,7 +3,9 @@
 #include <SDL2/SDL.h>
 
 Framebuffer::Framebuffer(GLsizei width, GLsizei height)
-    : m_width{width}, m_height{height}, m_target_texture{width, height, GL_RGBA32F} {
+    : m_width{width}, m_height{height}, m_target_texture{width, height, GL_RGBA32F}, m_depth_texture{width, height, GL_R32F},
+      m_accumulation_texture{width, height, GL_RGBA32F}, m_variance_texture{width, height, GL_RGBA32F},
+      m_normal_depth_texture{width, height, GL_RGBA16F}, m_albedo_texture{width, height, GL_RGBA8} {
     glCreateFramebuffers(1, &m_framebuffer_id);
     glNamedFramebufferTexture(m_framebuffer_id, GL_COLOR_ATTACHMENT0, m_target_texture.GetTextureID(), 0);
 
@@ -23,21 +25,32 @@ Framebuffer::~Framebuffer() {
 
 void Framebuffer::Bind() {
     glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer_id);
-    m_target_texture.Bind(0, GL_WRITE_ONLY);
+    m_target_texture.Bind(0, GL_READ_WRITE);
+    m_depth_texture.Bind(1, GL_READ_WRITE);
+    // the ray tracers add the new samples to the previous ones so they are read too
+    m_accumulation_texture.Bind(2, GL_READ_WRITE);
+    m_variance_texture.Bind(3, GL_READ_WRITE);
+    m_normal_depth_texture.Bind(4, GL_READ_WRITE);
+    m_albedo_texture.Bind(5, GL_READ_WRITE);
 }
 
 void Framebuffer::UnBind() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void Framebuffer::Blit() {
-    glBlitNamedFramebuffer(m_framebuffer_id, 0, 0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+void Framebuffer::Blit(GLsizei window_width, GLsizei window_height) {
+    glBlitNamedFramebuffer(m_framebuffer_id, 0, 0, 0, m_width, m_height, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
 }
 
 void Framebuffer::Resize(GLsizei width, GLsizei height) {
     m_width = width;
     m_height = height;
     m_target_texture.Resize(width, height);
+    m_depth_texture.Resize(width, height);
+    m_accumulation_texture.Resize(width, height);
+    m_variance_texture.Resize(width, height);
+    m_normal_depth_texture.Resize(width, height);
+    m_albedo_texture.Resize(width, height);
 
     glDeleteFramebuffers(1, &m_framebuffer_id);
     glDeleteRenderbuffers(1, &m_depthbuffer_id);
@@ -52,4 +65,16 @@ void Framebuffer::Resize(GLsizei width, GLsizei height) {
     if (glCheckNamedFramebufferStatus(m_framebuffer_id, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "Error while creating framebuffer");
     }
+}
+
+Texture2D& Framebuffer::GetAccumulationTexture() {
+    return m_accumulation_texture;
+}
+
+Texture2D& Framebuffer::GetVarianceTexture() {
+    return m_variance_texture;
+}
+
+Texture2D& Framebuffer::GetNormalDepthTexture() {
+    return m_normal_depth_texture;
 }
\ No newline at end of file
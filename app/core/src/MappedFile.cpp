@@ -0,0 +1,78 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_USE_MMAP
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& filename) : m_data{nullptr}, m_size{0}, m_is_open{false}, m_is_mapped{false} {
+    std::error_code ec;
+    size_t file_size = std::filesystem::file_size(filename, ec);
+    if (ec) {
+        return;
+    }
+
+    if (file_size == 0) {
+        // mmap can't map an empty range
+        m_is_open = true;
+        return;
+    }
+
+#ifdef MAPPED_FILE_USE_MMAP
+    int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor != -1) {
+        void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        close(file_descriptor); // the mapping keeps its own reference to the file
+
+        if (mapping != MAP_FAILED) {
+            // the parsers go through the file front to back, this makes the kernel read ahead more aggressively and start right away
+            madvise(mapping, file_size, MADV_SEQUENTIAL);
+            madvise(mapping, file_size, MADV_WILLNEED);
+
+            m_data = static_cast<const char*>(mapping);
+            m_size = file_size;
+            m_is_open = true;
+            m_is_mapped = true;
+            return;
+        }
+    }
+#endif
+
+    std::ifstream file{filename, std::ios::binary};
+    if (!file) {
+        return;
+    }
+
+    m_fallback_data.resize(file_size);
+    file.read(m_fallback_data.data(), file_size);
+
+    m_data = m_fallback_data.data();
+    m_size = file_size;
+    m_is_open = true;
+}
+
+MappedFile::~MappedFile() {
+#ifdef MAPPED_FILE_USE_MMAP
+    if (m_is_mapped) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+}
+
+bool MappedFile::IsOpen() const {
+    return m_is_open;
+}
+
+const char* MappedFile::GetData() const {
+    return m_data;
+}
+
+size_t MappedFile::GetSize() const {
+    return m_size;
+}
\ No newline at end of file
@@ -1,103 +1,213 @@
 #include "Mesh.hpp"
 
+#include "MappedFile.hpp"
+#include "MeshFile.hpp"
+#include "MeshSimplifier.hpp"
+#include "ObjParser.hpp"
+#include "PlyFile.hpp"
+#include "SmoothNormals.hpp"
+#include "ThreadPool.hpp"
+
 #include <SDL2/SDL.h>
-#include <string>
 #include <algorithm>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MESH_USE_SSE
+#endif
+
+
+constexpr size_t TRANSFORM_CHUNK_SIZE = 1 << 14;
+constexpr size_t LOD_MIN_TRIANGLE_COUNT = 64;
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+// the columns are summed in the same order as glm does, so the result is the same as with transform * vertex
+void TransformVertecies(const glm::mat4& transform, const glm::vec4* source, glm::vec4* destination, size_t count) {
+#ifdef MESH_USE_SSE
+    __m128 column_0 = _mm_loadu_ps(&transform[0].x);
+    __m128 column_1 = _mm_loadu_ps(&transform[1].x);
+    __m128 column_2 = _mm_loadu_ps(&transform[2].x);
+    __m128 column_3 = _mm_loadu_ps(&transform[3].x);
+
+    for (size_t i = 0; i < count; i++) {
+        __m128 v = _mm_loadu_ps(&source[i].x);
+
+        __m128 result = _mm_mul_ps(column_0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+        result = _mm_add_ps(result, _mm_mul_ps(column_1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+        result = _mm_add_ps(result, _mm_mul_ps(column_2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+        result = _mm_add_ps(result, _mm_mul_ps(column_3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        _mm_storeu_ps(&destination[i].x, result);
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        destination[i] = transform * source[i];
+    }
+#endif
+}
 
 
 Mesh::Mesh(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform) {
-    tinyobj::ObjReader reader;
+    if (filename.extension() == MESH_FILE_EXTENSION) {
+        LoadMeshFile(filename, material_id, transform);
+        return;
+    }
+    if (filename.extension() == PLY_FILE_EXTENSION) {
+        LoadPlyFile(filename, material_id, transform);
+        return;
+    }
 
-    if (!reader.ParseFromFile(filename)) {
-        if (!reader.Error().empty()) {
-            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] TinyObjReader loading error: %s", reader.Error().c_str());
-        }
+    ObjParser::Mesh mesh_object;
+    try {
+        // the ray tracer interpolates the normals, so generated ones are averaged around the vertecies
+        mesh_object = ObjParser::parse(filename, true, true);
+    } catch (ObjParser::Exception) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: couldn't open %s", filename.string().c_str());
         exit(1);
     }
 
-    if (!reader.Warning().empty()) {
-        SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_WARN, "[Mesh] TinyObjReader loading warning: %s", reader.Warning().c_str());
-    }
+    LoadMeshObject(mesh_object, material_id, transform);
+}
 
-    const tinyobj::attrib_t& attrib = reader.GetAttrib();
-    const std::vector<tinyobj::shape_t>& shapes = reader.GetShapes();
+Mesh::Mesh(const MeshObject<Vertex>& mesh_object, size_t material_id, glm::mat4 transform) {
+    LoadMeshObject(mesh_object, material_id, transform);
+}
 
-    if (attrib.normals.size() != 0) {
-        if (attrib.vertices.size() != attrib.normals.size()) {
-            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: obj file contains different amount of vertecies as to normals");
-            exit(1);
-        }
-    }
+Mesh::~Mesh() {}
 
-    bool has_normals = (attrib.normals.size() != 0);
+void Mesh::GenerateLods() {
+    m_lod_triangles = SimplifyMesh(m_vertecies, m_triangles, LOD_MIN_TRIANGLE_COUNT);
+}
 
-    std::vector<glm::vec3> normal_accumulator;
+void Mesh::LoadMeshFile(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform) {
+    MappedFile file{filename};
+    if (!file.IsOpen()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: couldn't open %s", filename.string().c_str());
+        exit(1);
+    }
 
-    for (size_t i = 0; i < attrib.vertices.size(); i += 3) {
-        GLfloat x = static_cast<GLfloat>(attrib.vertices[i + 0]);
-        GLfloat y = static_cast<GLfloat>(attrib.vertices[i + 1]);
-        GLfloat z = static_cast<GLfloat>(attrib.vertices[i + 2]);
+    MeshFileHeader header{};
+    if (file.GetSize() < sizeof(MeshFileHeader)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: %s is too small to be a mesh file", filename.string().c_str());
+        exit(1);
+    }
+    std::memcpy(&header, file.GetData(), sizeof(MeshFileHeader));
 
-        m_vertecies.push_back(transform * glm::vec4{x, y, z, 0.0f});
+    if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: %s is not a version %u mesh file", filename.string().c_str(), MESH_FILE_VERSION);
+        exit(1);
+    }
+
+    uint64_t vertecies_end = header.vertecies_offset + header.vertex_count * sizeof(glm::vec4);
+    uint64_t normals_end = header.normals_offset + header.vertex_count * sizeof(glm::vec4);
+    uint64_t triangles_end = header.triangles_offset + header.triangle_count * sizeof(glm::uvec4);
+    uint64_t lod_table_end = header.lod_table_offset + header.lod_count * sizeof(MeshFileLod);
+    if (std::max({vertecies_end, normals_end, triangles_end, lod_table_end}) > file.GetSize()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: %s is truncated", filename.string().c_str());
+        exit(1);
+    }
 
-        if (has_normals) {
-            GLfloat nx = static_cast<GLfloat>(attrib.normals[i + 0]);
-            GLfloat ny = static_cast<GLfloat>(attrib.normals[i + 1]);
-            GLfloat nz = static_cast<GLfloat>(attrib.normals[i + 2]);
-            m_normals.push_back(glm::vec4{nx, ny, nz, 0.0f});
-        } else {
-            normal_accumulator.push_back(glm::vec3{1.0f, 0.0f, 0.0f});
+    std::vector<MeshFileLod> lod_table(header.lod_count);
+    std::memcpy(lod_table.data(), file.GetData() + header.lod_table_offset, lod_table.size() * sizeof(MeshFileLod));
+    for (const MeshFileLod& lod : lod_table) {
+        if (lod.triangles_offset + lod.triangle_count * sizeof(glm::uvec4) > file.GetSize()) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: %s is truncated", filename.string().c_str());
+            exit(1);
         }
     }
 
-    for (const tinyobj::shape_t& shape : shapes) {
-        size_t i = 0;
+    // the arrays already have the in memory layout, so they are copied in bulk straight from the mapped pages
+    const glm::vec4* vertecies = reinterpret_cast<const glm::vec4*>(file.GetData() + header.vertecies_offset);
+    const glm::vec4* normals = reinterpret_cast<const glm::vec4*>(file.GetData() + header.normals_offset);
+    const glm::uvec4* triangles = reinterpret_cast<const glm::uvec4*>(file.GetData() + header.triangles_offset);
+
+    m_vertecies.assign(vertecies, vertecies + header.vertex_count);
+    m_normals.assign(normals, normals + header.vertex_count);
+    m_triangles.assign(triangles, triangles + header.triangle_count);
+    for (const MeshFileLod& lod : lod_table) {
+        const glm::uvec4* lod_triangles = reinterpret_cast<const glm::uvec4*>(file.GetData() + lod.triangles_offset);
+        m_lod_triangles.emplace_back(lod_triangles, lod_triangles + lod.triangle_count);
+    }
 
-        for (const size_t fv : shape.mesh.num_face_vertices) {
-            if (fv != 3) {
-                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error, only triangle faces are supported");    // tinyobjloader supposedly automatically converts all polygons to triangles if not specified otherwise
-                exit(1);
+    // only needed if the mesh is placed differently than it was converted (w is 0, same as for obj files)
+    if (transform != glm::mat4{1.0f}) {
+        ThreadPool::Shared().ParallelFor(m_vertecies.size(), TRANSFORM_CHUNK_SIZE, [this, &transform](size_t begin, size_t end) {
+            TransformVertecies(transform, m_vertecies.data() + begin, m_vertecies.data() + begin, end - begin);
+        });
+    }
+    if (material_id != header.material_id) {
+        for (glm::uvec4& triangle : m_triangles) {
+            triangle.w = static_cast<GLuint>(material_id);
+        }
+        for (std::vector<glm::uvec4>& level : m_lod_triangles) {
+            for (glm::uvec4& triangle : level) {
+                triangle.w = static_cast<GLuint>(material_id);
             }
+        }
+    }
+}
 
-            tinyobj::index_t i_1 = shape.mesh.indices[i + 0];
-            tinyobj::index_t i_2 = shape.mesh.indices[i + 1];
-            tinyobj::index_t i_3 = shape.mesh.indices[i + 2];
-
-            if (has_normals) {
-                if (i_1.vertex_index != i_1.normal_index || i_2.vertex_index != i_2.normal_index || i_3.vertex_index != i_3.normal_index) {
-                    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: different indecies for vertecies and normals are not supported");
-                    exit(1);
-                }
-            } else {
-                glm::vec3 v1 = glm::vec3{m_vertecies[i_1.vertex_index].x, m_vertecies[i_1.vertex_index].y, m_vertecies[i_1.vertex_index].z};
-                glm::vec3 v2 = glm::vec3{m_vertecies[i_2.vertex_index].x, m_vertecies[i_2.vertex_index].y, m_vertecies[i_2.vertex_index].z};
-                glm::vec3 v3 = glm::vec3{m_vertecies[i_3.vertex_index].x, m_vertecies[i_3.vertex_index].y, m_vertecies[i_3.vertex_index].z};
-
-                glm::vec3 triangle_normal = glm::normalize(glm::cross((v2 - v1), (v3 - v1)));
-
-                normal_accumulator[i_1.vertex_index] += triangle_normal;
-                normal_accumulator[i_2.vertex_index] += triangle_normal;
-                normal_accumulator[i_3.vertex_index] += triangle_normal;
+void Mesh::LoadPlyFile(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform) {
+    MappedFile file{filename};
+    if (!file.IsOpen()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: couldn't open %s", filename.string().c_str());
+        exit(1);
+    }
+
+    std::string error;
+    if (!ReadPlyFile(file.GetData(), file.GetSize(), m_vertecies, m_normals, m_triangles, static_cast<GLuint>(material_id), error)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Mesh] error: couldn't load %s: %s", filename.string().c_str(), error.c_str());
+        exit(1);
+    }
+
+    if (m_normals.empty()) {
+        // the same generated normals as for obj files, so a mesh shades the same in both formats
+        std::vector<unsigned int> triangle_positions(m_triangles.size() * 3);
+        std::vector<glm::vec3> triangle_normals(m_triangles.size());
+        ThreadPool::Shared().ParallelFor(m_triangles.size(), TRANSFORM_CHUNK_SIZE, [this, &triangle_positions, &triangle_normals](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const glm::uvec4& triangle = m_triangles[i];
+                triangle_positions[i * 3 + 0] = triangle.x;
+                triangle_positions[i * 3 + 1] = triangle.y;
+                triangle_positions[i * 3 + 2] = triangle.z;
+                triangle_normals[i] = GetTriangleNormal(glm::vec3{m_vertecies[triangle.x]}, glm::vec3{m_vertecies[triangle.y]}, glm::vec3{m_vertecies[triangle.z]});
             }
+        });
 
-            m_triangles.push_back(glm::uvec4(
-                static_cast<GLuint>(i_1.vertex_index), 
-                static_cast<GLuint>(i_2.vertex_index), 
-                static_cast<GLuint>(i_3.vertex_index), 
-                static_cast<GLuint>(material_id)));
+        std::vector<glm::vec3> normals = ComputeSmoothNormals(m_vertecies.size(), triangle_positions, triangle_normals);
+        m_normals.resize(m_vertecies.size());
+        ThreadPool::Shared().ParallelFor(m_normals.size(), TRANSFORM_CHUNK_SIZE, [this, &normals](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                m_normals[i] = glm::vec4{normals[i], 0.0f};
+            }
+        });
+    }
 
-            i += 3;
-        }
+    if (transform != glm::mat4{1.0f}) {
+        ThreadPool::Shared().ParallelFor(m_vertecies.size(), TRANSFORM_CHUNK_SIZE, [this, &transform](size_t begin, size_t end) {
+            TransformVertecies(transform, m_vertecies.data() + begin, m_vertecies.data() + begin, end - begin);
+        });
     }
+}
 
-    if (!has_normals) {
-        for (const glm::vec3& normal : normal_accumulator) {
-            m_normals.push_back(glm::vec4{glm::normalize(normal), 0.0f});
+void Mesh::LoadMeshObject(const MeshObject<Vertex>& mesh_object, size_t material_id, glm::mat4 transform) {
+    // the vertecies are already welded by position, normal and texcoord, so different indecies for positions and normals just become more vertecies
+    m_vertecies.resize(mesh_object.vertexArray.size());
+    m_normals.resize(mesh_object.vertexArray.size());
+    ThreadPool::Shared().ParallelFor(mesh_object.vertexArray.size(), TRANSFORM_CHUNK_SIZE, [this, &mesh_object, &transform](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            m_vertecies[i] = glm::vec4{mesh_object.vertexArray[i].position, 0.0f};
+            m_normals[i] = glm::vec4{mesh_object.vertexArray[i].normal, 0.0f};
         }
+        TransformVertecies(transform, m_vertecies.data() + begin, m_vertecies.data() + begin, end - begin);
+    });
+
+    m_triangles.reserve(mesh_object.indexArray.size() / 3);
+    for (size_t i = 0; i + 2 < mesh_object.indexArray.size(); i += 3) {
+        m_triangles.push_back(glm::uvec4(
+            mesh_object.indexArray[i + 0], 
+            mesh_object.indexArray[i + 1], 
+            mesh_object.indexArray[i + 2], 
+            static_cast<GLuint>(material_id)));
     }
 }
-
-Mesh::~Mesh() {}
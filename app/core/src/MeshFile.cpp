@@ -0,0 +1,60 @@
+#include "MeshFile.hpp"
+
+#include <fstream>
+
+uint64_t AlignTo16(uint64_t offset) {
+    return (offset + 15) & ~uint64_t{15};
+}
+
+bool WriteMeshFile(const std::filesystem::path& filename, const std::vector<glm::vec4>& vertecies, const std::vector<glm::vec4>& normals, const std::vector<glm::uvec4>& triangles, const std::vector<std::vector<glm::uvec4>>& lod_triangles, uint32_t material_id) {
+    MeshFileHeader header{};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.material_id = material_id;
+    header.vertex_count = vertecies.size();
+    header.triangle_count = triangles.size();
+    header.vertecies_offset = AlignTo16(sizeof(MeshFileHeader));
+    header.normals_offset = AlignTo16(header.vertecies_offset + vertecies.size() * sizeof(glm::vec4));
+    header.triangles_offset = AlignTo16(header.normals_offset + normals.size() * sizeof(glm::vec4));
+    header.lod_count = lod_triangles.size();
+    header.lod_table_offset = AlignTo16(header.triangles_offset + triangles.size() * sizeof(glm::uvec4));
+
+    std::vector<MeshFileLod> lod_table{};
+    uint64_t lod_triangles_end = header.lod_table_offset + lod_triangles.size() * sizeof(MeshFileLod);
+    for (const std::vector<glm::uvec4>& level : lod_triangles) {
+        lod_table.push_back(MeshFileLod{AlignTo16(lod_triangles_end), level.size()});
+        lod_triangles_end = lod_table.back().triangles_offset + level.size() * sizeof(glm::uvec4);
+    }
+
+    std::ofstream file{filename, std::ios::binary | std::ios::trunc};
+    if (!file) {
+        return false;
+    }
+
+    auto write_at = [&file](uint64_t offset, const void* data, size_t size) {
+        // zero padding up to the aligned offset
+        static const char padding[16] = {};
+        file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(MeshFileHeader));
+    write_at(header.vertecies_offset, vertecies.data(), vertecies.size() * sizeof(glm::vec4));
+    write_at(header.normals_offset, normals.data(), normals.size() * sizeof(glm::vec4));
+    write_at(header.triangles_offset, triangles.data(), triangles.size() * sizeof(glm::uvec4));
+    write_at(header.lod_table_offset, lod_table.data(), lod_table.size() * sizeof(MeshFileLod));
+    for (size_t i = 0; i < lod_triangles.size(); i++) {
+        write_at(lod_table[i].triangles_offset, lod_triangles[i].data(), lod_triangles[i].size() * sizeof(glm::uvec4));
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool IsCurrentMeshFile(const std::filesystem::path& filename) {
+    std::ifstream file{filename, std::ios::binary};
+    MeshFileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(MeshFileHeader))) {
+        return false;
+    }
+    return header.magic == MESH_FILE_MAGIC && header.version == MESH_FILE_VERSION;
+}
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+constexpr double BOUNDARY_WEIGHT = 100.0; // open edges are held in place by a plane perpendicular to their triangle
+
+// symmetric 4x4 matrix of a sum of squared plane distances, only the upper triangle is stored
+struct Quadric {
+    std::array<double, 10> q{};
+
+    Quadric() = default;
+    Quadric(glm::vec3 normal, float d, double weight) {
+        double a = normal.x, b = normal.y, c = normal.z, e = d;
+        q = {a * a, a * b, a * c, a * e, b * b, b * c, b * e, c * c, c * e, e * e};
+        for (double& value : q) {
+            value *= weight;
+        }
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        for (size_t i = 0; i < q.size(); i++) {
+            q[i] += other.q[i];
+        }
+        return *this;
+    }
+
+    double Error(glm::vec3 p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x 
+            + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y 
+            + q[7] * z * z + 2.0 * q[8] * z 
+            + q[9];
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+bool ContainsVertex(const glm::uvec4& triangle, uint32_t vertex) {
+    return triangle.x == vertex || triangle.y == vertex || triangle.z == vertex;
+}
+
+glm::uvec4 ReplaceVertex(glm::uvec4 triangle, uint32_t from, uint32_t to) {
+    triangle.x = (triangle.x == from) ? to : triangle.x;
+    triangle.y = (triangle.y == from) ? to : triangle.y;
+    triangle.z = (triangle.z == from) ? to : triangle.z;
+    return triangle;
+}
+
+// the simplification runs in passes: all edges are sorted by their cost and the cheapest ones are collapsed as long as they don't touch
+// a vertex that already moved in the pass, so the costs never go stale and only the edge list of one pass has to be kept around
+std::vector<std::vector<glm::uvec4>> SimplifyMesh(const std::vector<glm::vec4>& vertecies, const std::vector<glm::uvec4>& triangles, size_t min_triangle_count) {
+    std::vector<std::vector<glm::uvec4>> levels{};
+
+    auto position = [&vertecies](uint32_t vertex) {
+        return glm::vec3{vertecies[vertex].x, vertecies[vertex].y, vertecies[vertex].z};
+    };
+    auto face_normal = [&position](const glm::uvec4& triangle) {
+        glm::vec3 p0 = position(triangle.x);
+        return glm::cross(position(triangle.y) - p0, position(triangle.z) - p0);
+    };
+
+    std::vector<glm::uvec4> current = triangles;
+    std::vector<bool> is_triangle_alive(current.size(), false);
+    std::vector<std::vector<uint32_t>> vertex_triangles(vertecies.size());
+    std::vector<Quadric> quadrics(vertecies.size());
+    size_t live_triangle_count = 0;
+
+    std::vector<std::pair<uint64_t, uint32_t>> edges{};
+    edges.reserve(current.size() * 3);
+
+    for (size_t t = 0; t < current.size(); t++) {
+        const glm::uvec4& triangle = current[t];
+        if (triangle.x == triangle.y || triangle.y == triangle.z || triangle.z == triangle.x) {
+            continue;
+        }
+        is_triangle_alive[t] = true;
+        live_triangle_count++;
+
+        glm::vec3 normal = face_normal(triangle);
+        float double_area = glm::length(normal);
+        if (double_area > 0.0f) {
+            normal /= double_area;
+            // weighted by the area so big triangles keep their shape
+            Quadric plane{normal, -glm::dot(normal, position(triangle.x)), 0.5 * double_area};
+            quadrics[triangle.x] += plane;
+            quadrics[triangle.y] += plane;
+            quadrics[triangle.z] += plane;
+        }
+
+        for (uint32_t vertex : {triangle.x, triangle.y, triangle.z}) {
+            vertex_triangles[vertex].push_back(static_cast<uint32_t>(t));
+        }
+        edges.push_back({EdgeKey(triangle.x, triangle.y), static_cast<uint32_t>(t)});
+        edges.push_back({EdgeKey(triangle.y, triangle.z), static_cast<uint32_t>(t)});
+        edges.push_back({EdgeKey(triangle.z, triangle.x), static_cast<uint32_t>(t)});
+    }
+
+    // an edge that only one triangle uses is on the boundary
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ) {
+        size_t run_end = i + 1;
+        while (run_end < edges.size() && edges[run_end].first == edges[i].first) {
+            run_end++;
+        }
+        if (run_end - i == 1) {
+            uint32_t a = static_cast<uint32_t>(edges[i].first >> 32);
+            uint32_t b = static_cast<uint32_t>(edges[i].first & 0xFFFFFFFF);
+            glm::vec3 edge = position(b) - position(a);
+            glm::vec3 normal = glm::cross(edge, face_normal(current[edges[i].second]));
+            if (glm::length(normal) > 0.0f) {
+                normal = glm::normalize(normal);
+                Quadric plane{normal, -glm::dot(normal, position(a)), BOUNDARY_WEIGHT * glm::dot(edge, edge)};
+                quadrics[a] += plane;
+                quadrics[b] += plane;
+            }
+        }
+        i = run_end;
+    }
+    std::vector<std::pair<uint64_t, uint32_t>>{}.swap(edges);
+
+    // a collapse is rejected if it would flip or degenerate one of the triangles that stay
+    auto flips = [&](uint32_t from, uint32_t to) {
+        for (uint32_t t : vertex_triangles[from]) {
+            if (!is_triangle_alive[t] || ContainsVertex(current[t], to)) {
+                continue;
+            }
+            glm::vec3 normal_before = face_normal(current[t]);
+            glm::vec3 normal_after = face_normal(ReplaceVertex(current[t], from, to));
+            if (glm::length(normal_before) > 0.0f && glm::dot(normal_before, normal_after) <= 0.0f) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    size_t target_triangle_count = live_triangle_count / 4;
+    std::vector<bool> is_locked(vertecies.size(), false);
+    std::vector<uint64_t> edge_keys{};
+    std::vector<Collapse> collapses{};
+
+    while (target_triangle_count >= min_triangle_count) {
+        edge_keys.clear();
+        for (size_t t = 0; t < current.size(); t++) {
+            if (is_triangle_alive[t]) {
+                edge_keys.push_back(EdgeKey(current[t].x, current[t].y));
+                edge_keys.push_back(EdgeKey(current[t].y, current[t].z));
+                edge_keys.push_back(EdgeKey(current[t].z, current[t].x));
+            }
+        }
+        std::sort(edge_keys.begin(), edge_keys.end());
+        edge_keys.erase(std::unique(edge_keys.begin(), edge_keys.end()), edge_keys.end());
+
+        // every edge collapses into the end point that has the smaller error
+        collapses.clear();
+        for (uint64_t key : edge_keys) {
+            uint32_t a = static_cast<uint32_t>(key >> 32);
+            uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFF);
+            Quadric quadric = quadrics[a];
+            quadric += quadrics[b];
+            double cost_a = quadric.Error(position(a));
+            double cost_b = quadric.Error(position(b));
+            collapses.push_back((cost_a <= cost_b) ? Collapse{cost_a, b, a} : Collapse{cost_b, a, b});
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::fill(is_locked.begin(), is_locked.end(), false);
+        bool has_collapsed = false;
+
+        for (const Collapse& collapse : collapses) {
+            if (live_triangle_count <= target_triangle_count) {
+                break;
+            }
+            if (is_locked[collapse.from] || is_locked[collapse.to] || flips(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            std::vector<uint32_t>& to_triangles = vertex_triangles[collapse.to];
+            for (uint32_t t : vertex_triangles[collapse.from]) {
+                if (!is_triangle_alive[t]) {
+                    continue;
+                }
+                if (ContainsVertex(current[t], collapse.to)) {
+                    is_triangle_alive[t] = false;
+                    live_triangle_count--;
+                } else {
+                    current[t] = ReplaceVertex(current[t], collapse.from, collapse.to);
+                    to_triangles.push_back(t);
+                }
+            }
+            std::vector<uint32_t>{}.swap(vertex_triangles[collapse.from]);
+            to_triangles.erase(std::remove_if(to_triangles.begin(), to_triangles.end(), [&is_triangle_alive](uint32_t t) { return !is_triangle_alive[t]; }), to_triangles.end());
+            quadrics[collapse.to] += quadrics[collapse.from];
+
+            // the costs of every edge around the merged vertex changed, they wait for the next pass
+            is_locked[collapse.from] = true;
+            for (uint32_t t : to_triangles) {
+                is_locked[current[t].x] = true;
+                is_locked[current[t].y] = true;
+                is_locked[current[t].z] = true;
+            }
+            has_collapsed = true;
+        }
+
+        if (live_triangle_count <= target_triangle_count) {
+            std::vector<glm::uvec4> level{};
+            level.reserve(live_triangle_count);
+            for (size_t t = 0; t < current.size(); t++) {
+                if (is_triangle_alive[t]) {
+                    level.push_back(current[t]);
+                }
+            }
+            levels.push_back(std::move(level));
+            target_triangle_count = live_triangle_count / 4;
+        } else if (!has_collapsed) {
+            break;
+        }
+    }
+
+    return levels;
+}
\ No newline at end of file
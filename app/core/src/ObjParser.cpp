@@ -1,13 +1,16 @@
 #include "ObjParser.hpp"
-#include <array>
-#include <list>
 #include <string>
 #include <charconv>
 #include <algorithm>
+#include <limits>
 
 #include <glm/gtx/norm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include "MappedFile.hpp"
+#include "SmoothNormals.hpp"
+#include "ThreadPool.hpp"
+
 using namespace std;
 
 class InMemoryTokenizer
@@ -71,51 +74,471 @@ constexpr unsigned short From2Char( const char ch1, const char ch2)
 	return sh;
 }
 
-static std::vector<unsigned int> triangulatePolygon( const std::vector<glm::vec2>& );
+// reused by every face of a chunk, so once the vectors have grown to the biggest face triangulating doesn't allocate anymore
+struct TriangulationScratch
+{
+	std::vector<glm::vec3> centeredPoints;
+	std::vector<glm::vec2> projectedPoints;
+	std::vector<unsigned int> prevNode;
+	std::vector<unsigned int> nextNode;
+	std::vector<signed char> cornerType; // 1 convex, 0 flat, -1 reflex
+	std::vector<unsigned int> triIndices;
+};
+
+static bool isConvexQuad( const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3 );
+static void triangulatePolygon( TriangulationScratch& scratch );
+
+// obj exporters mostly write short decimals like -0.8203125, those are parsed in a single pass over the digits:
+// a mantissa up to 2^24 and a power of 10 up to 10^9 are both exact floats, so one division is rounded the same way as std::from_chars,
+// anything longer or with an exponent falls back to std::from_chars
+static inline void parseFloat( std::string_view token, float& value ) noexcept
+{
+	static constexpr float POWERS_OF_10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f };
+
+	const char* ptr = token.data();
+	const char* endPtr = token.data() + token.size();
+
+	const bool negative = ( ptr < endPtr && *ptr == '-' );
+	if ( negative ) ptr++;
+
+	uint32_t mantissa = 0;
+	unsigned int digits = 0;
+	unsigned int fractionDigits = 0;
+
+	for ( ; ptr < endPtr && static_cast<unsigned char>( *ptr - '0' ) < 10 && digits < 9; ++ptr, ++digits )
+	{
+		mantissa = mantissa * 10 + static_cast<uint32_t>( *ptr - '0' );
+	}
+	if ( ptr < endPtr && *ptr == '.' )
+	{
+		for ( ++ptr; ptr < endPtr && static_cast<unsigned char>( *ptr - '0' ) < 10 && digits < 9; ++ptr, ++digits, ++fractionDigits )
+		{
+			mantissa = mantissa * 10 + static_cast<uint32_t>( *ptr - '0' );
+		}
+	}
+
+	if ( ptr == endPtr && digits != 0 && mantissa <= ( 1u << 24 ) )
+	{
+		const float result = static_cast<float>( mantissa ) / POWERS_OF_10[ fractionDigits ];
+		value = negative ? -result : result;
+		return;
+	}
+
+	std::from_chars( token.data(), endPtr, value );
+}
+
+// everything that can be done without knowing the other chunks of the file
+struct ObjParser::Chunk
+{
+	const char* data = nullptr;
+	size_t size = 0;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+
+	std::vector<IndexedVert> faceVerts; // the indices in the file are global so they don't need to be fixed up
+	std::vector<unsigned int> faceSizes;
+	std::vector<unsigned char> faceNeedsNormals;
+	std::vector<size_t> normalsBeforeFace; // vn records of this chunk before the face
+	size_t texcoordsBeforeFirstFace = std::numeric_limits<size_t>::max(); // stays max if the chunk has no face
+
+	// filled once the positions of every chunk are known
+	std::vector<IndexedVert> triangleVerts;
+	std::vector<unsigned int> faceTriangleVertCounts;
+	std::vector<glm::vec3> mergedNormals; // the vn records and the computed normals in the order the serial parser pushes them
+};
+
+constexpr size_t MIN_PARALLEL_CHUNK_SIZE = 1 << 20;
+
+// the normal index of the vertices whose normal is generated by parseStreamed, the position is already part of their key
+constexpr uint32_t GENERATED_NORMAL = std::numeric_limits<uint32_t>::max();
 
-ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
+// open addressing with linear probing, the slots are a single allocation and nothing is allocated per insert
+struct ObjParser::IndexedVertTable
+{
+	struct Slot
+	{
+		IndexedVert key;
+		unsigned int value = 0; // the vertex index + 1, so 0 marks an empty slot
+	};
+
+	explicit IndexedVertTable( size_t expectedCount );
+
+	// a new key gets the value 0, which the caller has to overwrite
+	unsigned int& operator[]( const IndexedVert& key );
+
+private:
+	void grow();
+
+	std::vector<Slot> slots;
+	size_t mask = 0;
+	size_t count = 0;
+};
+
+ObjParser::IndexedVertTable::IndexedVertTable( size_t expectedCount )
+{
+	// the load factor is kept at most 1/2, the probe sequences stay short that way
+	size_t capacity = 16;
+	while ( capacity < expectedCount * 2 ) capacity <<= 1;
+
+	slots.resize( capacity );
+	mask = capacity - 1;
+}
+
+unsigned int& ObjParser::IndexedVertTable::operator[]( const IndexedVert& key )
+{
+	if ( ( count + 1 ) * 2 > slots.size() ) grow();
+
+	size_t i = IndexedVertHash()( key ) & mask;
+	while ( slots[ i ].value != 0 )
+	{
+		if ( slots[ i ].key == key ) return slots[ i ].value;
+		i = ( i + 1 ) & mask;
+	}
+
+	slots[ i ].key = key;
+	count++;
+	return slots[ i ].value;
+}
+
+void ObjParser::IndexedVertTable::grow()
+{
+	std::vector<Slot> oldSlots( slots.size() * 2 );
+	oldSlots.swap( slots );
+	mask = slots.size() - 1;
+
+	for ( const Slot& slot : oldSlots )
+	{
+		if ( slot.value == 0 ) continue;
+
+		size_t i = IndexedVertHash()( slot.key ) & mask;
+		while ( slots[ i ].value != 0 ) i = ( i + 1 ) & mask;
+		slots[ i ] = slot;
+	}
+}
+
+ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName, bool parallel, bool smoothNormals)
 {
 	Mesh resultMesh;
 
+	// the tokenizers read the mapped pages directly, nothing is copied
+	MappedFile objFile( fileName );
+
+	if ( !objFile.IsOpen() ) throw(EXC_FILENOTFOUND);
+
+	std::vector<Chunk> chunks = splitIntoChunks( objFile.GetData(), objFile.GetSize(), parallel );
+	size_t chunkCount = chunks.size();
+
+	ThreadPool::Shared().ParallelFor( chunkCount, 1, [ &chunks ]( size_t begin, size_t end )
+	{
+		for ( size_t i = begin; i < end; ++i ) parseRecords( chunks[ i ] );
+	} );
+
+	// merging the records, the faces only need the prefix counts
 	std::vector<glm::vec3> positions;
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> texcoords;
 
-	std::vector<IndexedVert> face_vertIds;
-	face_vertIds.reserve( 4 );
-	bool needsNormalComputation = false;
-	std::unordered_map<IndexedVert, unsigned int, IndexedVertHash> vertexIndices;
+	size_t positionCount = 0;
+	size_t texcoordCount = 0;
+	bool hasFace = false;
+	size_t texcoordsBeforeFirstFace = 0;
+	for ( const Chunk& chunk : chunks )
+	{
+		if ( !hasFace && chunk.texcoordsBeforeFirstFace != std::numeric_limits<size_t>::max() )
+		{
+			hasFace = true;
+			texcoordsBeforeFirstFace = texcoordCount + chunk.texcoordsBeforeFirstFace;
+		}
+		positionCount += chunk.positions.size();
+		texcoordCount += chunk.texcoords.size();
+	}
 
-	std::error_code ec;
-	std::size_t fileSize = std::filesystem::file_size( fileName, ec );
+	positions.reserve( positionCount );
+	texcoords.reserve( texcoordCount + 1 );
 
-	if ( ec ) throw(EXC_FILENOTFOUND);
+	// the serial parser adds a dummy texcoord at the first face if there was no vt record before it
+	if ( hasFace && texcoordsBeforeFirstFace == 0 ) texcoords.emplace_back( glm::vec2( 0.0 ) );
 
-	std::vector<char> objRawData( fileSize );
+	for ( Chunk& chunk : chunks )
+	{
+		positions.insert( positions.end(), chunk.positions.cbegin(), chunk.positions.cend() );
+		texcoords.insert( texcoords.end(), chunk.texcoords.cbegin(), chunk.texcoords.cend() );
+		std::vector<glm::vec3>().swap( chunk.positions );
+		std::vector<glm::vec2>().swap( chunk.texcoords );
+	}
 
-	std::ifstream objFileStrm( fileName, std::ios::binary );
+	ThreadPool::Shared().ParallelFor( chunkCount, 1, [ &chunks, &positions ]( size_t begin, size_t end )
+	{
+		for ( size_t i = begin; i < end; ++i ) triangulateFaces( chunks[ i ], positions );
+	} );
 
-	if ( !objFileStrm ) throw(EXC_FILENOTFOUND);
+	size_t normalCount = 0;
+	for ( const Chunk& chunk : chunks ) normalCount += chunk.mergedNormals.size();
+	normals.reserve( normalCount );
 
-	objFileStrm.read( objRawData.data(), fileSize );
+	// the computed normals are interleaved with the vn records, so their indices are shifted by the normals of the previous chunks
+	std::vector<size_t> chunkNormalOffsets( chunkCount );
+	for ( size_t i = 0; i < chunkCount; ++i )
+	{
+		chunkNormalOffsets[ i ] = normals.size();
+		normals.insert( normals.end(), chunks[ i ].mergedNormals.cbegin(), chunks[ i ].mergedNormals.cend() );
+		std::vector<glm::vec3>().swap( chunks[ i ].mergedNormals );
+	}
 
-	InMemoryTokenizer tokenizer;
+	// the triangles of a position all point to the sum of their normals, which is appended after the other normals
+	const size_t smoothNormalOffset = normals.size();
+	if ( smoothNormals )
+	{
+		// the triangle normals were computed with the triangulation, the three vertices of a triangle share one
+		std::vector<unsigned int> trianglePositions;
+		std::vector<glm::vec3> triangleNormals;
+		for ( size_t i = 0; i < chunkCount; ++i )
+		{
+			const Chunk& chunk = chunks[ i ];
+			size_t triangleVertOffset = 0;
 
-	tokenizer.SetData( objRawData.data(), fileSize );
+			for ( size_t f = 0; f < chunk.faceTriangleVertCounts.size(); ++f )
+			{
+				if ( chunk.faceNeedsNormals[ f ] )
+				{
+					for ( size_t k = triangleVertOffset; k < triangleVertOffset + chunk.faceTriangleVertCounts[ f ]; k += 3 )
+					{
+						trianglePositions.insert( trianglePositions.end(), { chunk.triangleVerts[ k ].v, chunk.triangleVerts[ k + 1 ].v, chunk.triangleVerts[ k + 2 ].v } );
+						triangleNormals.push_back( normals[ chunk.triangleVerts[ k ].vn + chunkNormalOffsets[ i ] ] );
+					}
+				}
+				triangleVertOffset += chunk.faceTriangleVertCounts[ f ];
+			}
+		}
+
+		std::vector<glm::vec3> smoothNormalArray = ComputeSmoothNormals( positions.size(), trianglePositions, triangleNormals );
+		normals.insert( normals.end(), smoothNormalArray.cbegin(), smoothNormalArray.cend() );
+	}
+
+	// a closed triangle mesh has about half as many vertices as faces, the table grows if split normals or texcoords add more
+	size_t faceCount = 0;
+	size_t triangleVertCount = 0;
+	for ( const Chunk& chunk : chunks )
+	{
+		faceCount += chunk.faceTriangleVertCounts.size();
+		triangleVertCount += chunk.triangleVerts.size();
+	}
+
+	IndexedVertTable vertexIndices( faceCount );
+	resultMesh.indexArray.reserve( triangleVertCount );
+
+	unsigned int nIndexedVerts = 0;
+
+	for ( size_t i = 0; i < chunkCount; ++i )
+	{
+		const Chunk& chunk = chunks[ i ];
+		size_t triangleVertOffset = 0;
+
+		for ( size_t f = 0; f < chunk.faceTriangleVertCounts.size(); ++f )
+		{
+			for ( size_t k = triangleVertOffset; k < triangleVertOffset + chunk.faceTriangleVertCounts[ f ]; ++k )
+			{
+				IndexedVert vertex = chunk.triangleVerts[ k ];
+				if ( chunk.faceNeedsNormals[ f ] )
+				{
+					vertex.vn = smoothNormals ? static_cast<uint32_t>( smoothNormalOffset + vertex.v ) : vertex.vn + static_cast<uint32_t>( chunkNormalOffsets[ i ] );
+				}
+
+				unsigned int& vIndex = vertexIndices[ vertex ];
+				if (vIndex == 0) // new vertex
+				{
+					Vertex v;
+					v.position = positions[vertex.v];
+					v.texcoord = texcoords[vertex.vt];
+					v.normal = normals[vertex.vn];
+
+					resultMesh.vertexArray.push_back(v);
+					resultMesh.indexArray.push_back(nIndexedVerts++);
+					vIndex = nIndexedVerts;	
+				} else {
+					resultMesh.indexArray.push_back(vIndex-1);
+				}
+			}
+			triangleVertOffset += chunk.faceTriangleVertCounts[ f ];
+		}
+	}
+
+	return resultMesh;
+}
+
+void ObjParser::parseStreamed(const std::filesystem::path& fileName, size_t windowSize,
+	const std::function<void(const std::vector<Vertex>&)>& onVertices,
+	const std::function<void(const std::vector<unsigned int>&)>& onTriangles,
+	const std::function<void(unsigned int, const glm::vec3&)>& onGeneratedNormal)
+{
+	// only the pages of the current window have to be resident
+	MappedFile objFile( fileName );
+
+	if ( !objFile.IsOpen() ) throw(EXC_FILENOTFOUND);
+
+	const char* objRawData = objFile.GetData();
+	std::size_t fileSize = objFile.GetSize();
+
+	// the faces of any later window can use these, so they are kept for the whole file
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	bool hasFace = false;
+
+	// the triangle normals are summed up per position in file order, the same as ComputeSmoothNormals does for parse
+	std::vector<glm::vec3> smoothNormalSums;
+	std::vector<std::pair<unsigned int, uint32_t>> smoothVertices; // the vertex and its position, the normal is only known at the end
 
+	IndexedVertTable vertexIndices( 1 << 16 );
 	unsigned int nIndexedVerts = 0;
+	std::vector<Vertex> windowVertices;
+	std::vector<unsigned int> windowIndices;
+
+	for ( size_t windowStart = 0; windowStart < fileSize; )
+	{
+		size_t windowEnd = windowStart + std::min( windowSize, fileSize - windowStart );
+		while ( windowEnd < fileSize && objRawData[ windowEnd - 1 ] != '\n' ) windowEnd++;
+
+		std::vector<Chunk> chunks = splitIntoChunks( objRawData + windowStart, windowEnd - windowStart, true );
+		windowStart = windowEnd;
+
+		ThreadPool::Shared().ParallelFor( chunks.size(), 1, [ &chunks ]( size_t begin, size_t end )
+		{
+			for ( size_t i = begin; i < end; ++i ) parseRecords( chunks[ i ] );
+		} );
+
+		for ( Chunk& chunk : chunks )
+		{
+			// the same dummy texcoord as in parse
+			if ( !hasFace && chunk.texcoordsBeforeFirstFace != std::numeric_limits<size_t>::max() )
+			{
+				hasFace = true;
+				if ( texcoords.empty() && chunk.texcoordsBeforeFirstFace == 0 ) texcoords.emplace_back( glm::vec2( 0.0 ) );
+			}
+
+			positions.insert( positions.end(), chunk.positions.cbegin(), chunk.positions.cend() );
+			texcoords.insert( texcoords.end(), chunk.texcoords.cbegin(), chunk.texcoords.cend() );
+			normals.insert( normals.end(), chunk.normals.cbegin(), chunk.normals.cend() ); // the chunk keeps its own for the triangulation
+			std::vector<glm::vec3>().swap( chunk.positions );
+			std::vector<glm::vec2>().swap( chunk.texcoords );
+		}
+		smoothNormalSums.resize( positions.size(), SMOOTH_NORMAL_START );
+
+		for ( const Chunk& chunk : chunks )
+		{
+			for ( const IndexedVert& vertex : chunk.faceVerts )
+			{
+				if ( vertex.v >= positions.size() || vertex.vt >= texcoords.size() ) throw(EXC_FORWARDREFERENCE);
+			}
+		}
+
+		ThreadPool::Shared().ParallelFor( chunks.size(), 1, [ &chunks, &positions ]( size_t begin, size_t end )
+		{
+			for ( size_t i = begin; i < end; ++i ) triangulateFaces( chunks[ i ], positions );
+		} );
+
+		// welded the same way as in parse, the vertices of the generated normals only by their position and texcoord
+		for ( const Chunk& chunk : chunks )
+		{
+			size_t triangleVertOffset = 0;
+
+			for ( size_t f = 0; f < chunk.faceTriangleVertCounts.size(); ++f )
+			{
+				for ( size_t k = triangleVertOffset; k < triangleVertOffset + chunk.faceTriangleVertCounts[ f ]; ++k )
+				{
+					IndexedVert vertex = chunk.triangleVerts[ k ];
+					if ( chunk.faceNeedsNormals[ f ] )
+					{
+						smoothNormalSums[ vertex.v ] += chunk.mergedNormals[ vertex.vn ];
+						vertex.vn = GENERATED_NORMAL;
+					}
+					else if ( vertex.vn >= normals.size() ) throw(EXC_FORWARDREFERENCE);
+
+					unsigned int& vIndex = vertexIndices[ vertex ];
+					if (vIndex == 0) // new vertex
+					{
+						Vertex v;
+						v.position = positions[vertex.v];
+						v.texcoord = texcoords[vertex.vt];
+						if ( vertex.vn == GENERATED_NORMAL )
+						{
+							v.normal = glm::vec3( 0.0f );
+							smoothVertices.emplace_back( nIndexedVerts, vertex.v );
+						}
+						else v.normal = normals[vertex.vn];
+
+						windowVertices.push_back(v);
+						vIndex = ++nIndexedVerts;
+					}
+					windowIndices.push_back( vIndex - 1 );
+				}
+				triangleVertOffset += chunk.faceTriangleVertCounts[ f ];
+			}
+		}
+
+		// the vertices have to arrive before the triangles that use them
+		onVertices( windowVertices );
+		onTriangles( windowIndices );
+		windowVertices.clear();
+		windowIndices.clear();
+	}
+
+	for ( const auto& [ vertex, position ] : smoothVertices )
+	{
+		onGeneratedNormal( vertex, FinishSmoothNormal( smoothNormalSums[ position ] ) );
+	}
+}
+
+std::vector<ObjParser::Chunk> ObjParser::splitIntoChunks( const char* data, size_t size, bool parallel )
+{
+	// the buffer is split at line boundaries, the serial mode is the same with a single chunk
+	size_t chunkCount = 1;
+	if ( parallel )
+	{
+		chunkCount = std::clamp<size_t>( size / MIN_PARALLEL_CHUNK_SIZE, 1, ThreadPool::Shared().GetThreadCount() + 1 );
+	}
+
+	std::vector<Chunk> chunks( chunkCount );
+	size_t chunkStart = 0;
+	for ( size_t i = 0; i < chunkCount; ++i )
+	{
+		size_t chunkEnd = std::max( chunkStart, ( i + 1 ) * size / chunkCount );
+		while ( chunkEnd < size && data[ chunkEnd - 1 ] != '\n' ) chunkEnd++;
+
+		chunks[ i ].data = data + chunkStart;
+		chunks[ i ].size = chunkEnd - chunkStart;
+		chunkStart = chunkEnd;
+	}
+
+	return chunks;
+}
+
+void ObjParser::parseRecords( Chunk& chunk )
+{
+	InMemoryTokenizer tokenizer;
+
+	tokenizer.SetData( chunk.data, chunk.size );
 
 	while ( tokenizer )
 	{
 		std::string_view token = tokenizer.NextToken();
 
+		// only whitespace was left
+		if ( token.empty() ) break;
+
 		if ( token[ 0 ] == '#' )
 		{
 			tokenizer.ToNextLine();
 			continue;
 		}
 
-		switch ( *reinterpret_cast<const unsigned short*>( token.data() ) )
+		// the second character is the one after the token for single character records,
+		// a mapped file has no readable byte after its end though
+		const char secondChar = ( token.data() + 1 < chunk.data + chunk.size ) ? token[ 1 ] : '\n';
+
+		switch ( From2Char( token[ 0 ], secondChar ) )
 		{
 			case From2Char('m','t'): //mtllib <.mtl file>
 			{
@@ -141,24 +564,24 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 			case From2Char('v',' '):
 			case From2Char('v','\t'): // v <x> <y> <z> [<w>]
 			{
-				positions.emplace_back(glm::vec3());
+				chunk.positions.emplace_back(glm::vec3());
 
-				float& x = positions.back().x;
-				float& y = positions.back().y;
-				float& z = positions.back().z;
+				float& x = chunk.positions.back().x;
+				float& y = chunk.positions.back().y;
+				float& z = chunk.positions.back().z;
 
 				std::string_view coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), x );
+				parseFloat( coordT, x );
 				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), y );
+				parseFloat( coordT, y );
 				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), z );
+				parseFloat( coordT, z );
 				coordT = tokenizer.NextToken(true);
 
 				if ( !coordT.empty() )
 				{
 					float w;
-					std::from_chars( coordT.data(), coordT.data() + coordT.size(), w );
+					parseFloat( coordT, w );
 					x /= w;
 					y /= w;
 					z /= w;
@@ -166,44 +589,46 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 			}break;
 			case From2Char('v','n'): // vn <nx> <ny> <nz>
 			{
-				normals.emplace_back(glm::vec3());
+				chunk.normals.emplace_back(glm::vec3());
 
-				float& x = normals.back().x;
-				float& y = normals.back().y;
-				float& z = normals.back().z;
+				float& x = chunk.normals.back().x;
+				float& y = chunk.normals.back().y;
+				float& z = chunk.normals.back().z;
 
 				std::string_view coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), x );
+				parseFloat( coordT, x );
 				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), y );
+				parseFloat( coordT, y );
 				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), z );
+				parseFloat( coordT, z );
 				
 			}break;
 			case From2Char('v','t'): // vt <s> <t>
 			{
-				texcoords.emplace_back(glm::vec2());
+				chunk.texcoords.emplace_back(glm::vec2());
 
-				float& s = texcoords.back().x;
-				float& t = texcoords.back().y;
+				float& s = chunk.texcoords.back().x;
+				float& t = chunk.texcoords.back().y;
 
 				std::string_view coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), s );
+				parseFloat( coordT, s );
 				coordT = tokenizer.NextToken();
-				std::from_chars( coordT.data(), coordT.data() + coordT.size(), t );
+				parseFloat( coordT, t );
 	
 			}break;
 			case From2Char('f',' '):
 			case From2Char('f','\t'): // f (<pi>[/<ti>][/<ni>])3+
 			{
-				face_vertIds.clear();
-				needsNormalComputation = false;
+				if ( chunk.texcoordsBeforeFirstFace == std::numeric_limits<size_t>::max() ) chunk.texcoordsBeforeFirstFace = chunk.texcoords.size();
+
+				bool needsNormalComputation = false;
+				size_t faceStart = chunk.faceVerts.size();
 
 				std::string_view faceVertT = tokenizer.NextToken( true );
 				while ( !faceVertT.empty() )
 				{
-					face_vertIds.emplace_back( IndexedVert{} );
-					IndexedVert& idxVert = face_vertIds.back();
+					chunk.faceVerts.emplace_back( IndexedVert{} );
+					IndexedVert& idxVert = chunk.faceVerts.back();
 
 					size_t posEndOffs = faceVertT.find_first_of( '/', 0 );
 					if ( posEndOffs == std::string_view::npos ) posEndOffs = faceVertT.size();
@@ -228,223 +653,233 @@ ObjParser::Mesh ObjParser::parse(const std::filesystem::path& fileName)
 					faceVertT = tokenizer.NextToken( true );
 				}
 
-				if ( 3 < face_vertIds.size() )
+				chunk.faceSizes.push_back( static_cast<unsigned int>( chunk.faceVerts.size() - faceStart ) );
+				chunk.faceNeedsNormals.push_back( needsNormalComputation );
+				chunk.normalsBeforeFace.push_back( chunk.normals.size() );
+			}break;
+		}
+
+		tokenizer.ToNextLine();
+	}
+}
+
+void ObjParser::triangulateFaces( Chunk& chunk, const std::vector<glm::vec3>& positions )
+{
+	std::vector<IndexedVert> face_vertIds;
+	std::vector<IndexedVert> face_vertIdsFace2Tris;
+	face_vertIds.reserve( 4 );
+	face_vertIdsFace2Tris.reserve( 6 );
+	TriangulationScratch scratch;
+
+	size_t faceVertOffset = 0;
+	size_t mergedNormalRecords = 0;
+
+	for ( size_t f = 0; f < chunk.faceSizes.size(); ++f )
+	{
+		face_vertIds.assign( chunk.faceVerts.cbegin() + faceVertOffset, chunk.faceVerts.cbegin() + faceVertOffset + chunk.faceSizes[ f ] );
+		faceVertOffset += chunk.faceSizes[ f ];
+
+		if ( 3 < face_vertIds.size() )
+		{
+			// a convex quad can be split along either diagonal without projecting it first
+			if ( 4 == face_vertIds.size() && isConvexQuad( positions[ face_vertIds[ 0 ].v ], positions[ face_vertIds[ 1 ].v ],
+														   positions[ face_vertIds[ 2 ].v ], positions[ face_vertIds[ 3 ].v ] ) )
+			{
+				glm::vec3 v10 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 1 ].v ];
+				glm::vec3 v12 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 1 ].v ];
+
+				glm::vec3 v32 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 3 ].v ];
+				glm::vec3 v30 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 3 ].v ];
+
+				float angle_012 = ::acosf( glm::dot(v10,v12) / sqrtf( glm::dot(v10,v10) * glm::dot(v12,v12) ) );
+				float angle_230 = ::acosf( glm::dot(v32,v30) / sqrtf( glm::dot(v32,v32) * glm::dot(v30,v30) ) );
+				
+				if ( ( angle_012 + angle_230 ) <= glm::pi<float>() )
+				{
+					face_vertIdsFace2Tris =
+					{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 2 ],
+					  face_vertIds[ 0 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
+				}
+				else
+				{
+					face_vertIdsFace2Tris =
+					{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 3 ],
+					  face_vertIds[ 1 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
+				}
+			}
+			else 
+			{
+				// Calculate the best fitting plane
+				glm::vec3 MidPoint( 0.0 );
+				for ( const auto& vertex : face_vertIds )
+				{
+					MidPoint += positions[ vertex.v ];
+				}
+				MidPoint /= float( face_vertIds.size() );
+
+				std::vector<glm::vec3>& centeredPoints = scratch.centeredPoints;
+				centeredPoints.resize( face_vertIds.size() );
+
+				std::transform( face_vertIds.cbegin(), face_vertIds.cend(), centeredPoints.begin(),
+								[&positions,MidPoint]( const IndexedVert& faceV )->glm::vec3
+								{ return positions[ faceV.v ] - MidPoint;}
+								);
+
+				float cov_xx = 0.0f, cov_xy = 0.0f;
+				float cov_yy = 0.0f, cov_yz = 0.0f;
+				float cov_xz = 0.0f, cov_zz = 0.0f;
+
+				for ( const glm::vec3& centeredP : centeredPoints )
+				{
+					cov_xx += centeredP.x * centeredP.x;
+					cov_xy += centeredP.x * centeredP.y;
+					
+					cov_yy += centeredP.y * centeredP.y;
+					cov_yz += centeredP.y * centeredP.z;
+
+					cov_xz += centeredP.x * centeredP.z;
+					cov_zz += centeredP.z * centeredP.z;
+				}
+
+				// viktor-vad: Very strange, but the pca.hpp and pca.inc disappeared from glm/gtx.
+				// Did not find any explanation for this.
+				// Instead of some header file copy-hacking, I implemented a 3x3 verion of eigen decomposition.
+				// It was not intended, but most likely it is faster than the original glm pca, since that is a general method with Housholder and QR.
+				// https://dl.acm.org/doi/epdf/10.1145/355578.366316
+				// https://en.wikipedia.org/wiki/Eigenvalue_algorithm#2%C3%972_matrices
+				glm::vec3 eigenVectors[2];
 				{
-					std::vector<IndexedVert> face_vertIdsFace2Tris;
-					if ( 4 == face_vertIds.size() )
+					glm::vec3 eigenVectors_[3];
+					float p1 = cov_xy * cov_xy + cov_xz * cov_xz + cov_yz * cov_yz;
+					float trC = cov_xx + cov_yy + cov_zz;
+					float eig1 = 0.0f, eig2 = 0.0f, eig3 = 0.0f;
+
+					// normal case
+					if ( p1 > 1e-15f )
 					{
-						glm::vec3 v10 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 1 ].v ];
-						glm::vec3 v12 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 1 ].v ];
+						float q = trC / 3.0f;
+						float p2 = ( cov_xx - q ) * ( cov_xx - q ) + ( cov_yy - q ) * ( cov_yy - q ) + ( cov_zz - q ) * ( cov_zz - q ) + 2.0f * p1;
+						float p = std::sqrt( p2 / 6.0f );
 
-						glm::vec3 v32 = positions[ face_vertIds[ 2 ].v ] - positions[ face_vertIds[ 3 ].v ];
-						glm::vec3 v30 = positions[ face_vertIds[ 0 ].v ] - positions[ face_vertIds[ 3 ].v ];
+						float cov_xx_q = cov_xx - q;
+						float cov_yy_q = cov_yy - q;
+						float cov_zz_q = cov_zz - q;
 
-						float angle_012 = ::acosf( glm::dot(v10,v12) / sqrtf( glm::dot(v10,v10) * glm::dot(v12,v12) ) );
-						float angle_230 = ::acosf( glm::dot(v32,v30) / sqrtf( glm::dot(v32,v32) * glm::dot(v30,v30) ) );
-						
-						if ( ( angle_012 + angle_230 ) <= glm::pi<float>() )
-						{
-							face_vertIdsFace2Tris =
-							{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 2 ],
-							  face_vertIds[ 0 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
-						}
-						else
-						{
-							face_vertIdsFace2Tris =
-							{ face_vertIds[ 0 ], face_vertIds[ 1 ], face_vertIds[ 3 ],
-							  face_vertIds[ 1 ], face_vertIds[ 2 ], face_vertIds[ 3 ] };
-						}
+						float r = glm::clamp( ( cov_xx_q * cov_yy_q * cov_zz_q + 2.0f * cov_xy * cov_yz * cov_xz - cov_xx_q * cov_yz * cov_yz - cov_yy_q * cov_xz * cov_xz - cov_zz_q * cov_xy * cov_xy ) / ( 2.0f * p * p * p ),
+											  -1.0f, 1.0f );
+
+						float phi = ::acosf( r ) / 3.0f;
+
+						eig1 = q + 2.0f * p * std::cos( phi );
+						eig2 = q + 2.0f * p * std::cos( phi + ( 2.0f * glm::pi<float>() / 3.0f ) );
+						eig3 = trC - eig1 - eig2;
 					}
-					else 
+					else // covariance matrix is numericaly diagonal. We assume eigen values are the diagonal values.
 					{
-						// Calculate the best fitting plane
-						glm::vec3 MidPoint( 0.0 );
-						for ( const auto& vertex : face_vertIds )
-						{
-							MidPoint += positions[ vertex.v ];
-						}
-						MidPoint /= float( face_vertIds.size() );
-
-						std::vector<glm::vec3> centeredPoints( face_vertIds.size() );
+						eig1 = std::max( { cov_xx, cov_yy, cov_zz } );
+						eig3 = std::min( { cov_xx, cov_yy, cov_zz } );
+						eig2 = trC - eig1 - eig2;
+					}
 
-						std::transform( face_vertIds.cbegin(), face_vertIds.cend(), centeredPoints.begin(),
-										[&positions,MidPoint]( const IndexedVert& faceV )->glm::vec3
-										{ return positions[ faceV.v ] - MidPoint;}
-										);
+					eigenVectors_[ 0 ] = glm::vec3( cov_xy * cov_xy + cov_xz * cov_xz + ( cov_xx - eig2 ) * ( cov_xx - eig3 ),
+												   cov_xy * ( ( cov_xx - eig3 ) + ( cov_yy - eig2 ) ) + cov_xz * cov_yz,
+												   cov_xz * ( ( cov_xx - eig3 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz );
 
-						float cov_xx = 0.0f, cov_xy = 0.0f;
-						float cov_yy = 0.0f, cov_yz = 0.0f;
-						float cov_xz = 0.0f, cov_zz = 0.0f;
+					eigenVectors_[ 1 ] = glm::vec3( cov_xy * ( ( cov_xx - eig1 ) + ( cov_yy - eig3 ) ) + cov_xz * cov_yz,
+												   cov_yz * cov_yz + cov_xy * cov_xy + ( cov_yy - eig1 ) * ( cov_yy - eig3 ),
+												   cov_yz * ( ( cov_yy - eig3 ) + ( cov_zz - eig1 ) ) + cov_xy * cov_xz );
 
-						for ( const glm::vec3& centeredP : centeredPoints )
-						{
-							cov_xx += centeredP.x * centeredP.x;
-							cov_xy += centeredP.x * centeredP.y;
-							
-							cov_yy += centeredP.y * centeredP.y;
-							cov_yz += centeredP.y * centeredP.z;
-
-							cov_xz += centeredP.x * centeredP.z;
-							cov_zz += centeredP.z * centeredP.z;
-						}
+					eigenVectors_[ 2 ] = glm::vec3( cov_xz * ( ( cov_xx - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz,
+												   cov_yz * ( ( cov_yy - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_xz,
+												   cov_yz * cov_yz + cov_xz * cov_xz + ( cov_zz - eig1 ) * ( cov_zz - eig2 ) );
+					
+					// Simplification of original method.
+					// We only need the first 2 eigen vectors for 2D projection.
+					// Therefor we are not intereted, which is bigger, but in leaving the smallest out.
+					float minEig = std::min( { eig1, eig2, eig3 } );
 
-						// viktor-vad: Very strange, but the pca.hpp and pca.inc disappeared from glm/gtx.
-						// Did not find any explanation for this.
-						// Instead of some header file copy-hacking, I implemented a 3x3 verion of eigen decomposition.
-						// It was not intended, but most likely it is faster than the original glm pca, since that is a general method with Housholder and QR.
-						// https://dl.acm.org/doi/epdf/10.1145/355578.366316
-						// https://en.wikipedia.org/wiki/Eigenvalue_algorithm#2%C3%972_matrices
-						glm::vec3 eigenVectors[2];
-						{
-							glm::vec3 eigenVectors_[3];
-							float p1 = cov_xy * cov_xy + cov_xz * cov_xz + cov_yz * cov_yz;
-							float trC = cov_xx + cov_yy + cov_zz;
-							float eig1 = 0.0f, eig2 = 0.0f, eig3 = 0.0f;
-
-							// normal case
-							if ( p1 > 1e-15f )
-							{
-								float q = trC / 3.0f;
-								float p2 = ( cov_xx - q ) * ( cov_xx - q ) + ( cov_yy - q ) * ( cov_yy - q ) + ( cov_zz - q ) * ( cov_zz - q ) + 2.0f * p1;
-								float p = std::sqrt( p2 / 6.0f );
-
-								float cov_xx_q = cov_xx - q;
-								float cov_yy_q = cov_yy - q;
-								float cov_zz_q = cov_zz - q;
-
-								float r = glm::clamp( ( cov_xx_q * cov_yy_q * cov_zz_q + 2.0f * cov_xy * cov_yz * cov_xz - cov_xx_q * cov_yz * cov_yz - cov_yy_q * cov_xz * cov_xz - cov_zz_q * cov_xy * cov_xy ) / ( 2.0f * p * p * p ),
-													  -1.0f, 1.0f );
-
-								float phi = ::acosf( r ) / 3.0f;
-
-								eig1 = q + 2.0f * p * std::cos( phi );
-								eig2 = q + 2.0f * p * std::cos( phi + ( 2.0f * glm::pi<float>() / 3.0f ) );
-								eig3 = trC - eig1 - eig2;
-							}
-							else // covariance matrix is numericaly diagonal. We assume eigen values are the diagonal values.
-							{
-								eig1 = std::max( { cov_xx, cov_yy, cov_zz } );
-								eig3 = std::min( { cov_xx, cov_yy, cov_zz } );
-								eig2 = trC - eig1 - eig2;
-							}
-
-							eigenVectors_[ 0 ] = glm::vec3( cov_xy * cov_xy + cov_xz * cov_xz + ( cov_xx - eig2 ) * ( cov_xx - eig3 ),
-														   cov_xy * ( ( cov_xx - eig3 ) + ( cov_yy - eig2 ) ) + cov_xz * cov_yz,
-														   cov_xz * ( ( cov_xx - eig3 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz );
-
-							eigenVectors_[ 1 ] = glm::vec3( cov_xy * ( ( cov_xx - eig1 ) + ( cov_yy - eig3 ) ) + cov_xz * cov_yz,
-														   cov_yz * cov_yz + cov_xy * cov_xy + ( cov_yy - eig1 ) * ( cov_yy - eig3 ),
-														   cov_yz * ( ( cov_yy - eig3 ) + ( cov_zz - eig1 ) ) + cov_xy * cov_xz );
-
-							eigenVectors_[ 2 ] = glm::vec3( cov_xz * ( ( cov_xx - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_yz,
-														   cov_yz * ( ( cov_yy - eig1 ) + ( cov_zz - eig2 ) ) + cov_xy * cov_xz,
-														   cov_yz * cov_yz + cov_xz * cov_xz + ( cov_zz - eig1 ) * ( cov_zz - eig2 ) );
-							
-							// Simplification of original method.
-							// We only need the first 2 eigen vectors for 2D projection.
-							// Therefor we are not intereted, which is bigger, but in leaving the smallest out.
-							float minEig = std::min( { eig1, eig2, eig3 } );
-
-							if ( eig3 == minEig )
-							{
-								eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
-								eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 1 ] );
-							}
-							else if ( eig2 == minEig )
-							{
+					if ( eig3 == minEig )
+					{
+						eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
+						eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 1 ] );
+					}
+					else if ( eig2 == minEig )
+					{
                                 eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 0 ] );
                                 eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 2 ] );
                             }
-							else //if ( eig1 == minEig ) most unlikly case
-							{
+					else //if ( eig1 == minEig ) most unlikly case
+					{
                                 eigenVectors[ 0 ] = glm::normalize( eigenVectors_[ 1 ] );
                                 eigenVectors[ 1 ] = glm::normalize( eigenVectors_[ 2 ] );
                             }
-						}
-
-						std::vector<glm::vec2> facePointsProjected( face_vertIds.size() );
-						
-
-						std::transform(centeredPoints.cbegin(),centeredPoints.cend(),facePointsProjected.begin(),
-										[ &eigenVectors ]( const glm::vec3& cp )->glm::vec2
-										{
-											return glm::vec2(
-												glm::dot( cp, eigenVectors[0] ),
-												glm::dot( cp, eigenVectors[1] )
-											);
-										} );
-
-						// checking the orientation. CCW should be kept
-						float sum = 0.0;
-						for ( int i = 0; i < facePointsProjected.size() - 1; ++i )
-						{
-							sum += ( facePointsProjected[ i + 1 ].x - facePointsProjected[ i ].x ) *
-								( facePointsProjected[ i + 1 ].y + facePointsProjected[ i ].y );
-						}
-						sum += ( facePointsProjected.front().x - facePointsProjected.back().x ) *
-							( facePointsProjected.front().y + facePointsProjected.back().y );
-
-						if ( sum > 0.0f )
-						{
-							for ( int i = 0; i < facePointsProjected.size(); ++i )
-								facePointsProjected[ i ].y *= -1.0f;
-						}
+				}
 
-						std::vector<unsigned int> triIndices = triangulatePolygon( facePointsProjected );
-						
-						face_vertIdsFace2Tris.resize( triIndices.size() );
-						std::transform( triIndices.cbegin(), triIndices.cend(), face_vertIdsFace2Tris.begin(),
-										[ &face_vertIds ]( const unsigned int fTriId )->IndexedVert
-										{
-											return face_vertIds[ fTriId ];
-										} );
+				std::vector<glm::vec2>& facePointsProjected = scratch.projectedPoints;
+				facePointsProjected.resize( face_vertIds.size() );
+				
 
-					}
-					face_vertIds = std::move( face_vertIdsFace2Tris );
+				std::transform(centeredPoints.cbegin(),centeredPoints.cend(),facePointsProjected.begin(),
+								[ &eigenVectors ]( const glm::vec3& cp )->glm::vec2
+								{
+									return glm::vec2(
+										glm::dot( cp, eigenVectors[0] ),
+										glm::dot( cp, eigenVectors[1] )
+									);
+								} );
+
+				// checking the orientation. CCW should be kept
+				float sum = 0.0;
+				for ( int i = 0; i < facePointsProjected.size() - 1; ++i )
+				{
+					sum += ( facePointsProjected[ i + 1 ].x - facePointsProjected[ i ].x ) *
+						( facePointsProjected[ i + 1 ].y + facePointsProjected[ i ].y );
 				}
-				
-				if ( texcoords.empty() ) texcoords.emplace_back( glm::vec2( 0.0 ) );
-				
-				if ( needsNormalComputation )
+				sum += ( facePointsProjected.front().x - facePointsProjected.back().x ) *
+					( facePointsProjected.front().y + facePointsProjected.back().y );
+
+				if ( sum > 0.0f )
 				{
-					for ( int i = 0; i < face_vertIds.size(); i += 3 )
-					{
-						glm::vec3 n = glm::normalize( glm::cross(
-							positions[face_vertIds[i + 1].v] - positions[face_vertIds[i].v],
-							positions[face_vertIds[i + 2].v] - positions[face_vertIds[i].v]
-						) );
-
-						unsigned int n_idx = static_cast<unsigned int>( normals.size() );
-						normals.push_back( n );
-						face_vertIds[ i ].vn = face_vertIds[ i + 1 ].vn = face_vertIds[ i + 2 ].vn = n_idx;
-					}
+					for ( int i = 0; i < facePointsProjected.size(); ++i )
+						facePointsProjected[ i ].y *= -1.0f;
 				}
 
+				triangulatePolygon( scratch );
+				const std::vector<unsigned int>& triIndices = scratch.triIndices;
+				
+				face_vertIdsFace2Tris.resize( triIndices.size() );
+				std::transform( triIndices.cbegin(), triIndices.cend(), face_vertIdsFace2Tris.begin(),
+								[ &face_vertIds ]( const unsigned int fTriId )->IndexedVert
+								{
+									return face_vertIds[ fTriId ];
+								} );
 
-				for ( const auto& vertex : face_vertIds )
-				{
-					unsigned int& vIndex = vertexIndices[ vertex ];
-					if (vIndex == 0) // new vertex
-					{
-						Vertex v;
-						v.position = positions[vertex.v];
-						v.texcoord = texcoords[vertex.vt];
-						v.normal = normals[vertex.vn];
+			}
+			face_vertIds.swap( face_vertIdsFace2Tris ); // swapped instead of moved so both keep their capacity
+		}
 
-						resultMesh.vertexArray.push_back(v);
-						resultMesh.indexArray.push_back(nIndexedVerts++);
-						vIndex = nIndexedVerts;	
-					} else {
-						resultMesh.indexArray.push_back(vIndex-1);
-					}
-				}
-			}break;
+		chunk.mergedNormals.insert( chunk.mergedNormals.end(), chunk.normals.cbegin() + mergedNormalRecords, chunk.normals.cbegin() + chunk.normalsBeforeFace[ f ] );
+		mergedNormalRecords = chunk.normalsBeforeFace[ f ];
+
+		if ( chunk.faceNeedsNormals[ f ] )
+		{
+			for ( int i = 0; i < face_vertIds.size(); i += 3 )
+			{
+				glm::vec3 n = GetTriangleNormal( positions[face_vertIds[i].v], positions[face_vertIds[i + 1].v], positions[face_vertIds[i + 2].v] );
+
+				unsigned int n_idx = static_cast<unsigned int>( chunk.mergedNormals.size() );
+				chunk.mergedNormals.push_back( n );
+				face_vertIds[ i ].vn = face_vertIds[ i + 1 ].vn = face_vertIds[ i + 2 ].vn = n_idx;
+			}
 		}
 
-		tokenizer.ToNextLine();
+		chunk.triangleVerts.insert( chunk.triangleVerts.end(), face_vertIds.cbegin(), face_vertIds.cend() );
+		chunk.faceTriangleVertCounts.push_back( static_cast<unsigned int>( face_vertIds.size() ) );
 	}
+	chunk.mergedNormals.insert( chunk.mergedNormals.end(), chunk.normals.cbegin() + mergedNormalRecords, chunk.normals.cend() );
 
-	return resultMesh;
+	std::vector<IndexedVert>().swap( chunk.faceVerts );
+	std::vector<glm::vec3>().swap( chunk.normals );
 }
 
 // Hash function for IndexedVert
@@ -474,162 +909,119 @@ static inline constexpr uint64_t fasthash64( uint64_t v, uint64_t seed )
 
 std::size_t ObjParser::IndexedVertHash::operator()( const IndexedVert& iv ) const noexcept
 {
-	return fasthash64( iv.vt, iv.vn_64 );
+	return fasthash64( iv.v_vt, iv.vn_64 );
 }
 
-static std::vector<unsigned int> triangulatePolygon( const std::vector<glm::vec2>& polygon )
+static bool isConvexQuad( const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3 )
 {
-	constexpr float M_2PI = glm::two_pi<float>();
-	using Edge = std::array<unsigned int, 2>;
+	// both diagonals have to separate the other two corners (degenerate quads count as convex, they were always split like this)
+	const glm::vec3 d02 = p2 - p0;
+	const glm::vec3 d13 = p3 - p1;
 
-	struct
-	{
-		std::vector<unsigned int> triIdxList;
-		
-		void AppendTriangle( unsigned int i0, unsigned int i1, unsigned int i2 )
-		{
-			triIdxList.push_back( i0 );
-			triIdxList.push_back( i1 );
-			triIdxList.push_back( i2 );
-		}
+	return glm::dot( glm::cross( d02, p1 - p0 ), glm::cross( d02, p3 - p0 ) ) <= 0.0f
+		&& glm::dot( glm::cross( d13, p2 - p1 ), glm::cross( d13, p0 - p1 ) ) <= 0.0f;
+}
 
-		void SetTriangle( unsigned int triIdx, unsigned int i0, unsigned int i1, unsigned int i2 )
-		{
-			triIdxList[ triIdx * 3    ] = i0;
-			triIdxList[ triIdx * 3 + 1] = i1;
-			triIdxList[ triIdx * 3 + 2] = i2;
-		}
+// ear clipping of the counter clockwise scratch.projectedPoints into scratch.triIndices, the remaining corners are a linked list over the scratch arrays
+// an ear is a convex corner without a reflex corner inside its triangle, so while no reflex corner is left (always for convex polygons) every convex corner
+// is an ear and the polygon is clipped in linear time
+static void triangulatePolygon( TriangulationScratch& scratch )
+{
+	const std::vector<glm::vec2>& polygon = scratch.projectedPoints;
+	const unsigned int nodeCount = static_cast<unsigned int>( polygon.size() );
 
-		bool findTri4Edge( const Edge& edge, unsigned int& triIdx, unsigned int& oppositeIdx ) const noexcept
-		{
-			for ( triIdx = static_cast<unsigned int>(triIdxList.size()) / 3 - 1;
-				  static_cast<int>( triIdx ) >= 0;
-				  triIdx-- ) // usually the neighbouring triangles are pushed later
-			{
-				if ( ( triIdxList[ 3 * triIdx ] == edge[ 0 ] ) && ( triIdxList[ 3 * triIdx + 1 ] == edge[ 1 ] ) )
-				{
-					oppositeIdx = triIdxList[ 3 * triIdx + 2 ];
-					return true;
-				}
-				if ( ( triIdxList[ 3 * triIdx + 1] == edge[ 0 ] ) && ( triIdxList[ 3 * triIdx + 2 ] == edge[ 1 ] ) )
-				{
-					oppositeIdx = triIdxList[ 3 * triIdx ];
-					return true;
-				}
-				if ( ( triIdxList[ 3 * triIdx + 2] == edge[ 0 ] ) && ( triIdxList[ 3 * triIdx ] == edge[ 1 ] ) )
-				{
-					oppositeIdx = triIdxList[ 3 * triIdx + 1 ];
-					return true;
-				}
-			}
+	std::vector<unsigned int>& prevNode = scratch.prevNode;
+	std::vector<unsigned int>& nextNode = scratch.nextNode;
+	std::vector<signed char>& cornerType = scratch.cornerType;
+	std::vector<unsigned int>& triIndices = scratch.triIndices;
 
-			return false;
-		}
+	prevNode.resize( nodeCount );
+	nextNode.resize( nodeCount );
+	cornerType.assign( nodeCount, 0 );
+	triIndices.clear();
+	triIndices.reserve( ( nodeCount - 2 ) * 3 );
 
-	} triangulation;
-	triangulation.triIdxList.reserve( polygon.size() * 3 - 6 );
+	for ( unsigned int i = 0; i < nodeCount; ++i )
+	{
+		prevNode[ i ] = ( i + nodeCount - 1 ) % nodeCount;
+		nextNode[ i ] = ( i + 1 ) % nodeCount;
+	}
 
-	struct PolygonNode
+	auto edgeSide = []( const glm::vec2& a, const glm::vec2& b, const glm::vec2& p )->float
 	{
-		unsigned int id;
-		float angle;
+		return ( b.x - a.x ) * ( p.y - a.y ) - ( b.y - a.y ) * ( p.x - a.x );
 	};
 
-	std::vector<PolygonNode> polygonNodes( polygon.size() );
-	std::list< std::array<unsigned int, 2> > edges2check;
-
-	auto advNode = [ &polygonNodes ]( const size_t i,const long int di )->size_t
+	unsigned int reflexCount = 0;
+	auto updateCorner = [ & ]( const unsigned int i )->void
 	{
-		 return ( polygonNodes.size() + i + di ) % polygonNodes.size();
+		if ( cornerType[ i ] < 0 ) reflexCount--;
+
+		const float side = edgeSide( polygon[ prevNode[ i ] ], polygon[ i ], polygon[ nextNode[ i ] ] );
+		cornerType[ i ] = ( side > 0.0f ) ? 1 : ( ( side < 0.0f ) ? -1 : 0 );
+
+		if ( cornerType[ i ] < 0 ) reflexCount++;
 	};
 
-	auto computeAngle = [ & ]( const size_t i )->void
+	auto isEar = [ & ]( const unsigned int i )->bool
 	{
-		glm::vec2 prevP = polygon[ polygonNodes[advNode(i,-1)].id ];
-		glm::vec2     P = polygon[ polygonNodes[        i    ].id ];
-		glm::vec2 postP = polygon[ polygonNodes[advNode(i, 1)].id ];
+		if ( cornerType[ i ] <= 0 ) return false;
+		if ( reflexCount == 0 ) return true;
 
-		float angle1 = atan2f( prevP.y - P.y, prevP.x - P.x );
-		float angle2 = atan2f( postP.y - P.y, postP.x - P.x );
+		const glm::vec2& a = polygon[ prevNode[ i ] ];
+		const glm::vec2& b = polygon[ i ];
+		const glm::vec2& c = polygon[ nextNode[ i ] ];
 
-		polygonNodes[ i ].angle = angle1 - angle2;
-		if ( polygonNodes[ i ].angle < 0.0f )
+		for ( unsigned int j = nextNode[ nextNode[ i ] ]; j != prevNode[ i ]; j = nextNode[ j ] )
 		{
-			polygonNodes[ i ].angle += M_2PI;
-		}
+			if ( cornerType[ j ] >= 0 ) continue;
 
+			const glm::vec2& p = polygon[ j ];
+			if ( edgeSide( a, b, p ) >= 0.0f && edgeSide( b, c, p ) >= 0.0f && edgeSide( c, a, p ) >= 0.0f ) return false;
+		}
+		return true;
 	};
 
-	for ( unsigned int i = 0; i < polygonNodes.size(); ++i )
+	for ( unsigned int i = 0; i < nodeCount; ++i )
 	{
-		polygonNodes[ i ].id = i;
+		updateCorner( i );
 	}
-	for ( unsigned int i = 0; i < polygonNodes.size(); ++i )
-	{
-		computeAngle( i );
-	}
-
-	while ( polygonNodes.size() > 2 )
-	{
-		unsigned int minAngleIdx = static_cast<unsigned int>( 
-			std::distance( polygonNodes.cbegin(), 
-						   std::min_element( polygonNodes.cbegin(), polygonNodes.cend(),
-						[]( const PolygonNode& n1, const PolygonNode& n2 ) { return n1.angle < n2.angle; } 
-						) ) );
-
-		const unsigned int i0 = polygonNodes[ advNode( minAngleIdx, -1 ) ].id;
-		const unsigned int i1 = polygonNodes[          minAngleIdx       ].id;
-		const unsigned int i2 = polygonNodes[ advNode( minAngleIdx,  1 ) ].id;
-
-		triangulation.AppendTriangle( i0, i1, i2 );
 
-		edges2check.push_back( { i0, i1 });
-		edges2check.push_back( { i1, i2 });
-		edges2check.push_back( { i2, i0 });
+	unsigned int remainingCount = nodeCount;
+	unsigned int current = 0;
+	unsigned int stepsWithoutEar = 0;
 
-		for ( ; !edges2check.empty(); edges2check.pop_front() )
+	while ( remainingCount > 3 )
+	{
+		// a self intersecting or numerically degenerate polygon can run out of ears, then the corner is clipped anyway
+		if ( isEar( current ) || stepsWithoutEar == remainingCount )
 		{
-			const Edge& edge2check = edges2check.front();
-			const unsigned int _idx0 = edge2check[ 0 ];
-			const unsigned int _idx2 = edge2check[ 1 ];
+			const unsigned int prev = prevNode[ current ];
+			const unsigned int next = nextNode[ current ];
 
-			unsigned int leftTriIdx, _idx3;
-			bool leftFound = triangulation.findTri4Edge( edge2check, leftTriIdx, _idx3 );
-			unsigned int rightTriIdx, _idx1;
-			bool rightFound = triangulation.findTri4Edge( { edge2check[ 1 ], edge2check[ 0 ] }, rightTriIdx, _idx1 );
+			triIndices.push_back( prev );
+			triIndices.push_back( current );
+			triIndices.push_back( next );
 
-			if ( leftFound && rightFound )
-			{
-				const glm::vec2& P0 = polygon[ _idx0 ];
-				const glm::vec2& P1 = polygon[ _idx1 ];
-				const glm::vec2& P2 = polygon[ _idx2 ];
-				const glm::vec2& P3 = polygon[ _idx3 ];
+			if ( cornerType[ current ] < 0 ) reflexCount--;
+			nextNode[ prev ] = next;
+			prevNode[ next ] = prev;
+			remainingCount--;
 
-				const glm::vec2 P0mP3 = P0 - P3;
-				const glm::vec2 P1mP3 = P1 - P3;
-				const glm::vec2 P2mP3 = P2 - P3;
+			updateCorner( prev );
+			updateCorner( next );
 
-				glm::mat3 D( P0mP3.x, P0mP3.y, glm::dot( P0mP3, P0mP3 ),
-							 P1mP3.x, P1mP3.y, glm::dot( P1mP3, P1mP3 ),
-							 P2mP3.x, P2mP3.y, glm::dot( P2mP3, P2mP3 )
-				);
-
-				if ( glm::determinant( D ) > 0.0 )
-				{
-					triangulation.SetTriangle( leftTriIdx,  _idx0, _idx1, _idx3 );
-					triangulation.SetTriangle( rightTriIdx, _idx1, _idx2, _idx3 );
-
-					edges2check.push_back( { _idx0, _idx1 } );
-					edges2check.push_back( { _idx1, _idx2 } );
-					edges2check.push_back( { _idx2, _idx3 } );
-					edges2check.push_back( { _idx3, _idx0 } );
-				}
-			}
+			current = next;
+			stepsWithoutEar = 0;
+		}
+		else
+		{
+			current = nextNode[ current ];
+			stepsWithoutEar++;
 		}
-
-		polygonNodes.erase( polygonNodes.cbegin() + minAngleIdx );
-		computeAngle( advNode( minAngleIdx, -1 ) );
-		computeAngle( advNode( minAngleIdx,  0 ) );
 	}
-	return triangulation.triIdxList;
+
+	triIndices.push_back( prevNode[ current ] );
+	triIndices.push_back( current );
+	triIndices.push_back( nextNode[ current ] );
 }
\ No newline at end of file
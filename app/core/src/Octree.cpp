@@ -1,12 +1,28 @@
 #include "Octree.hpp"
 
 #include "TriangleBoxIntersection.hpp"
+#include "ThreadPool.hpp"
+#include "ObjParser.hpp"
+
+#include <SDL2/SDL.h>
 
 #include <limits>
 #include <numeric>
 #include <algorithm>
 #include <string>
 #include <cmath>
+#include <mutex>
+#include <tuple>
+#include <iterator>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCTREE_USE_SSE2
+#endif
 
 
 #include <iostream>
@@ -35,6 +51,131 @@ std::string SizeToString(size_t size_in_bytes) {
 
 }
 
+constexpr size_t MERGE_CHUNK_SIZE = 1 << 16;
+
+// the compressed node has 3 more values after its child pointers if this bit of the info is set: the start and count of the
+// lod triangles and the feature size (float bits), the child count only uses the lower 4 bits
+constexpr uint32_t LOD_NODE_FLAG = 0x80;
+// a node gets the coarsest level whose edges are at most this many times smaller than the node (same as in ray_tracer.frag)
+constexpr float LOD_NODE_RESOLUTION = 4.0f;
+
+// computes the bounds of the vertecies and if destination is not null copies them there in the same pass
+AABB CopyAndComputeBounds(const glm::vec4* source, glm::vec4* destination, size_t count) {
+#ifdef OCTREE_USE_SSE2
+    // glm::vec4 is 4 tightly packed floats, so it can be loaded as one register (the unused w lane does not matter)
+    __m128 min_bounds_1 = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 min_bounds_2 = min_bounds_1;
+    __m128 max_bounds_1 = _mm_set1_ps(-1.0f * std::numeric_limits<float>::infinity());
+    __m128 max_bounds_2 = max_bounds_1;
+
+    size_t i = 0;
+    for (; i + 1 < count; i += 2) {
+        __m128 v1 = _mm_loadu_ps(&source[i + 0].x);
+        __m128 v2 = _mm_loadu_ps(&source[i + 1].x);
+
+        min_bounds_1 = _mm_min_ps(min_bounds_1, v1);
+        min_bounds_2 = _mm_min_ps(min_bounds_2, v2);
+        max_bounds_1 = _mm_max_ps(max_bounds_1, v1);
+        max_bounds_2 = _mm_max_ps(max_bounds_2, v2);
+
+        if (destination != nullptr) {
+            _mm_storeu_ps(&destination[i + 0].x, v1);
+            _mm_storeu_ps(&destination[i + 1].x, v2);
+        }
+    }
+    for (; i < count; i++) {
+        __m128 v = _mm_loadu_ps(&source[i].x);
+
+        min_bounds_1 = _mm_min_ps(min_bounds_1, v);
+        max_bounds_1 = _mm_max_ps(max_bounds_1, v);
+
+        if (destination != nullptr) {
+            _mm_storeu_ps(&destination[i].x, v);
+        }
+    }
+
+    glm::vec4 min_bounds;
+    glm::vec4 max_bounds;
+    _mm_storeu_ps(&min_bounds.x, _mm_min_ps(min_bounds_1, min_bounds_2));
+    _mm_storeu_ps(&max_bounds.x, _mm_max_ps(max_bounds_1, max_bounds_2));
+
+    return AABB{glm::vec3{min_bounds}, glm::vec3{max_bounds}};
+#else
+    glm::vec3 min_bounds{std::numeric_limits<float>::infinity()};
+    glm::vec3 max_bounds{-1.0f * std::numeric_limits<float>::infinity()};
+
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 v{source[i].x, source[i].y, source[i].z};
+        min_bounds = glm::min(min_bounds, v);
+        max_bounds = glm::max(max_bounds, v);
+
+        if (destination != nullptr) {
+            destination[i] = source[i];
+        }
+    }
+
+    return AABB{min_bounds, max_bounds};
+#endif
+}
+
+void CopyWithIndexOffset(const glm::uvec4* source, glm::uvec4* destination, size_t count, GLuint index_offset) {
+#ifdef OCTREE_USE_SSE2
+    // the w component is the material id, it must not be offset
+    __m128i offset = _mm_set_epi32(0, static_cast<int>(index_offset), static_cast<int>(index_offset), static_cast<int>(index_offset));
+
+    for (size_t i = 0; i < count; i++) {
+        __m128i ind = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i]), _mm_add_epi32(ind, offset));
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        destination[i] = source[i] + glm::uvec4{index_offset, index_offset, index_offset, 0};
+    }
+#endif
+}
+
+void CopyWithIndexOffsetAndMaterial(const glm::uvec4* source, glm::uvec4* destination, size_t count, GLuint index_offset, GLuint material_id) {
+#ifdef OCTREE_USE_SSE2
+    __m128i offset = _mm_set_epi32(0, static_cast<int>(index_offset), static_cast<int>(index_offset), static_cast<int>(index_offset));
+    __m128i index_mask = _mm_set_epi32(0, -1, -1, -1);
+    __m128i material = _mm_set_epi32(static_cast<int>(material_id), 0, 0, 0);
+
+    for (size_t i = 0; i < count; i++) {
+        __m128i ind = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i]));
+        ind = _mm_or_si128(_mm_and_si128(_mm_add_epi32(ind, offset), index_mask), material);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i]), ind);
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        destination[i] = glm::uvec4{source[i].x + index_offset, source[i].y + index_offset, source[i].z + index_offset, material_id};
+    }
+#endif
+}
+
+size_t GetLodCount(const std::vector<Mesh>& meshes) {
+    size_t lod_count = 0;
+    for (const Mesh& mesh : meshes) {
+        lod_count = std::max(lod_count, mesh.m_lod_triangles.size());
+    }
+    return lod_count;
+}
+
+// every level has to cover the whole scene, so meshes with fewer levels use their coarsest one (or all of their triangles)
+void AppendLods(const Mesh& mesh, std::vector<std::vector<glm::uvec4>>& lod_levels, GLuint index_offset, const GLuint* material_id) {
+    for (size_t level = 0; level < lod_levels.size(); level++) {
+        const std::vector<glm::uvec4>& source = mesh.m_lod_triangles.empty() ? mesh.m_triangles : mesh.m_lod_triangles[std::min(level, mesh.m_lod_triangles.size() - 1)];
+        std::vector<glm::uvec4>& destination = lod_levels[level];
+
+        size_t start = destination.size();
+        destination.resize(start + source.size());
+        if (material_id != nullptr) {
+            CopyWithIndexOffsetAndMaterial(source.data(), destination.data() + start, source.size(), index_offset, *material_id);
+        } else {
+            CopyWithIndexOffset(source.data(), destination.data() + start, source.size(), index_offset);
+        }
+    }
+}
+
 void Octree::DepthFirstCompress(std::unique_ptr<OctreeNode>& node, size_t parent_node_child_pointer_location) {
     if (parent_node_child_pointer_location != 0) {
         uint32_t node_start = static_cast<uint32_t>(m_compressed_node_buffer.size());
@@ -54,10 +195,21 @@ void Octree::DepthFirstCompress(std::unique_ptr<OctreeNode>& node, size_t parent
         }
     }
     
-    uint32_t node_info = (triangle_count << 16) | (children_mask << 8) | children_count;
+    bool has_lod = !node->lod_triangles.empty();
+    uint32_t node_info = (triangle_count << 16) | (children_mask << 8) | children_count | (has_lod ? LOD_NODE_FLAG : 0);
     uint32_t triangle_start = static_cast<uint32_t>(m_compressed_triangles.size());
 
+    node->compressed_node_start = m_compressed_node_buffer.size();
+    node->compressed_node_capacity = 2 + children_count + (has_lod ? 3 : 0);
+    node->compressed_triangle_start = triangle_start;
+    node->compressed_triangle_capacity = node->triangles.size();
+    node->compressed_lod_triangle_start = triangle_start + node->triangles.size();
+    node->compressed_lod_triangle_capacity = node->lod_triangles.size();
+    node->triangles_changed = false;
+    node->subtree_changed = false;
+
     m_compressed_triangles.insert(m_compressed_triangles.end(), node->triangles.cbegin(), node->triangles.cend());
+    m_compressed_triangles.insert(m_compressed_triangles.end(), node->lod_triangles.cbegin(), node->lod_triangles.cend());
     //for (const glm::uvec4& ind : node->triangles) {
     //    m_compressed_triangles.push_back(static_cast<uint32_t>(ind.x));
     //    m_compressed_triangles.push_back(static_cast<uint32_t>(ind.y));
@@ -74,6 +226,21 @@ void Octree::DepthFirstCompress(std::unique_ptr<OctreeNode>& node, size_t parent
         m_compressed_node_buffer.push_back(placeholder);
     }
 
+    if (has_lod) {
+        uint32_t lod_feature_size_bits;
+        std::memcpy(&lod_feature_size_bits, &node->lod_feature_size, sizeof(uint32_t));
+
+        m_compressed_node_buffer.push_back(static_cast<uint32_t>(node->compressed_lod_triangle_start));
+        m_compressed_node_buffer.push_back(static_cast<uint32_t>(node->lod_triangles.size()));
+        m_compressed_node_buffer.push_back(lod_feature_size_bits);
+    }
+
+    if (node.get() == m_root.get()) {
+        // the root has room for all 8 child pointers so incremental updates can always rewrite it in place (the shader starts at 0)
+        m_compressed_node_buffer.resize(child_pointers_start + 8, 0);
+        node->compressed_node_capacity = 2 + 8;
+    }
+
     size_t child_pointer_offset = 0;
     for (size_t i = 0; i < 8; i++) {
         if (children_mask & (0x01 << i)) {
@@ -200,59 +367,149 @@ void Octree::Subdivide(std::unique_ptr<OctreeNode>& node, size_t current_depth)
 
 }
 
-Octree::Octree(std::vector<Mesh> meshes, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps) : 
+Octree::Octree(std::vector<Mesh>&& meshes, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps) : 
     m_max_depth{0}, 
     m_depth_limit{depth_limit}, 
     m_max_triangles_per_node{max_triangles_per_node},
     m_max_triangles_per_leaf{max_triangles_per_leaf}, 
     m_keep_triangles_after_this_many_overlaps{m_keep_triangles_after_this_many_overlaps}
 {
-    std::vector<glm::vec4> combined_vertecies{};
-    std::vector<glm::vec4> combined_normals{};
+    size_t vertex_count = std::accumulate(meshes.begin(), meshes.end(), size_t{0}, [](size_t sum, const Mesh& mesh) {return sum + mesh.m_vertecies.size();});
+    size_t triangle_count = std::accumulate(meshes.begin(), meshes.end(), size_t{0}, [](size_t sum, const Mesh& mesh) {return sum + mesh.m_triangles.size();});
+
     std::vector<glm::uvec4> combined_triangles{};
+    std::vector<std::vector<glm::uvec4>> lod_levels(GetLodCount(meshes));
 
-    combined_vertecies.reserve(std::accumulate(meshes.begin(), meshes.end(), 0, [](size_t sum, const Mesh& mesh) {return sum + mesh.m_vertecies.size();}));
-    combined_normals.reserve(std::accumulate(meshes.begin(), meshes.end(), 0, [](size_t sum, const Mesh& mesh) {return sum + mesh.m_normals.size();}));
-    combined_triangles.reserve(std::accumulate(meshes.begin(), meshes.end(), 0, [](size_t sum, const Mesh& mesh) {return sum + mesh.m_triangles.size();}));
+    size_t mesh_vertex_start = 0;
+    for (const Mesh& mesh : meshes) {
+        m_meshes.push_back(MeshRecord{mesh_vertex_start, mesh.m_vertecies.size(), true, {}});
+        mesh_vertex_start += mesh.m_vertecies.size();
+    }
 
     glm::vec3 min_bounds{std::numeric_limits<float>::infinity()};
     glm::vec3 max_bounds{-1.0f * std::numeric_limits<float>::infinity()};
 
-    for (const Mesh& mesh : meshes) {
-        GLuint prev_size = static_cast<GLuint>(combined_vertecies.size());
-
-        combined_vertecies.insert(combined_vertecies.end(), mesh.m_vertecies.cbegin(), mesh.m_vertecies.cend());
-        combined_normals.insert(combined_normals.end(), mesh.m_normals.cbegin(), mesh.m_normals.cend());
-        std::transform(
-            mesh.m_triangles.cbegin(), 
-            mesh.m_triangles.cend(), 
-            std::back_inserter(combined_triangles), 
-            [prev_size](glm::uvec4 ind) {
-                return ind + glm::uvec4{prev_size, prev_size, prev_size, 0};
-            });
+    // the bounds are reduced straight over the vertex arrays (every vertex is visited once instead of once per triangle)
+    // and for several meshes the reduction is fused with the copy into the combined buffer
+    std::mutex bounds_mutex;
+    auto merge_bounds = [&](const AABB& bounds) {
+        std::lock_guard<std::mutex> lock{bounds_mutex};
+        min_bounds = glm::min(min_bounds, bounds.min_bounds);
+        max_bounds = glm::max(max_bounds, bounds.max_bounds);
+    };
 
-        for (const glm::uvec4& ind : mesh.m_triangles) {
-            glm::vec3 v1{mesh.m_vertecies[ind.x].x, mesh.m_vertecies[ind.x].y, mesh.m_vertecies[ind.x].z};
-            glm::vec3 v2{mesh.m_vertecies[ind.y].x, mesh.m_vertecies[ind.y].y, mesh.m_vertecies[ind.y].z};
-            glm::vec3 v3{mesh.m_vertecies[ind.z].x, mesh.m_vertecies[ind.z].y, mesh.m_vertecies[ind.z].z};
+    if (meshes.size() == 1) {
+        // a single mesh already has the combined layout so its buffers can be taken over without copying
+        m_vertecies = std::move(meshes[0].m_vertecies);
+        m_normals = std::move(meshes[0].m_normals);
+        combined_triangles = std::move(meshes[0].m_triangles);
+        lod_levels = std::move(meshes[0].m_lod_triangles);
 
-            min_bounds = glm::min(min_bounds, v1);
-            min_bounds = glm::min(min_bounds, v2);
-            min_bounds = glm::min(min_bounds, v3);
+        ThreadPool::Shared().ParallelFor(m_vertecies.size(), MERGE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            merge_bounds(CopyAndComputeBounds(m_vertecies.data() + begin, nullptr, end - begin));
+        });
+    } else {
+        m_vertecies.resize(vertex_count);
+        m_normals.resize(vertex_count);
+        combined_triangles.resize(triangle_count);
 
-            max_bounds = glm::max(max_bounds, v1);
-            max_bounds = glm::max(max_bounds, v2);
-            max_bounds = glm::max(max_bounds, v3);
+        size_t vertex_offset = 0;
+        size_t triangle_offset = 0;
+
+        for (Mesh& mesh : meshes) {
+            GLuint index_offset = static_cast<GLuint>(vertex_offset);
+
+            ThreadPool::Shared().ParallelFor(mesh.m_vertecies.size(), MERGE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+                merge_bounds(CopyAndComputeBounds(mesh.m_vertecies.data() + begin, m_vertecies.data() + vertex_offset + begin, end - begin));
+                std::copy(mesh.m_normals.cbegin() + begin, mesh.m_normals.cbegin() + end, m_normals.begin() + vertex_offset + begin);
+            });
+            ThreadPool::Shared().ParallelFor(mesh.m_triangles.size(), MERGE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+                CopyWithIndexOffset(mesh.m_triangles.data() + begin, combined_triangles.data() + triangle_offset + begin, end - begin, index_offset);
+            });
+            AppendLods(mesh, lod_levels, index_offset, nullptr);
+
+            vertex_offset += mesh.m_vertecies.size();
+            triangle_offset += mesh.m_triangles.size();
+
+            // the source mesh is not needed anymore, releasing it right away keeps the peak memory close to a single copy of the geometry
+            std::vector<glm::vec4>{}.swap(mesh.m_vertecies);
+            std::vector<glm::vec4>{}.swap(mesh.m_normals);
+            std::vector<glm::uvec4>{}.swap(mesh.m_triangles);
+            std::vector<std::vector<glm::uvec4>>{}.swap(mesh.m_lod_triangles);
         }
     }
 
-    m_vertecies = std::move(combined_vertecies);
-    m_normals = std::move(combined_normals);
+    BuildMerged(std::move(combined_triangles), min_bounds, max_bounds, lod_levels);
+}
 
-    m_root = std::make_unique<OctreeNode>(OctreeNode{AABB{min_bounds, max_bounds}, combined_triangles, {}, true});
-    
-    Subdivide(m_root, 1);
-    DepthFirstCompress(m_root, 0);
+Octree::Octree(const std::vector<MeshInstance>& instances, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps) : 
+    m_max_depth{0}, 
+    m_depth_limit{depth_limit}, 
+    m_max_triangles_per_node{max_triangles_per_node},
+    m_max_triangles_per_leaf{max_triangles_per_leaf}, 
+    m_keep_triangles_after_this_many_overlaps{m_keep_triangles_after_this_many_overlaps}
+{
+    size_t vertex_count = std::accumulate(instances.begin(), instances.end(), size_t{0}, [](size_t sum, const MeshInstance& instance) {return sum + instance.mesh->m_vertecies.size();});
+    size_t triangle_count = std::accumulate(instances.begin(), instances.end(), size_t{0}, [](size_t sum, const MeshInstance& instance) {return sum + instance.mesh->m_triangles.size();});
+
+    m_vertecies.resize(vertex_count);
+    m_normals.resize(vertex_count);
+    std::vector<glm::uvec4> combined_triangles(triangle_count);
+
+    size_t lod_count = 0;
+    for (const MeshInstance& instance : instances) {
+        lod_count = std::max(lod_count, instance.mesh->m_lod_triangles.size());
+    }
+    std::vector<std::vector<glm::uvec4>> lod_levels(lod_count);
+
+    glm::vec3 min_bounds{std::numeric_limits<float>::infinity()};
+    glm::vec3 max_bounds{-1.0f * std::numeric_limits<float>::infinity()};
+
+    std::mutex bounds_mutex;
+    auto merge_bounds = [&](const AABB& bounds) {
+        std::lock_guard<std::mutex> lock{bounds_mutex};
+        min_bounds = glm::min(min_bounds, bounds.min_bounds);
+        max_bounds = glm::max(max_bounds, bounds.max_bounds);
+    };
+
+    // the shared meshes are untransformed, every instance is transformed and given its material while it is copied into the combined buffers
+    size_t vertex_offset = 0;
+    size_t triangle_offset = 0;
+
+    for (const MeshInstance& instance : instances) {
+        const Mesh& mesh = *instance.mesh;
+        GLuint index_offset = static_cast<GLuint>(vertex_offset);
+        GLuint material_id = static_cast<GLuint>(instance.material_id);
+
+        m_meshes.push_back(MeshRecord{vertex_offset, mesh.m_vertecies.size(), true, {}});
+
+        ThreadPool::Shared().ParallelFor(mesh.m_vertecies.size(), MERGE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            TransformVertecies(instance.transform, mesh.m_vertecies.data() + begin, m_vertecies.data() + vertex_offset + begin, end - begin);
+            merge_bounds(CopyAndComputeBounds(m_vertecies.data() + vertex_offset + begin, nullptr, end - begin));
+            std::copy(mesh.m_normals.cbegin() + begin, mesh.m_normals.cbegin() + end, m_normals.begin() + vertex_offset + begin);
+        });
+        ThreadPool::Shared().ParallelFor(mesh.m_triangles.size(), MERGE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            CopyWithIndexOffsetAndMaterial(mesh.m_triangles.data() + begin, combined_triangles.data() + triangle_offset + begin, end - begin, index_offset, material_id);
+        });
+        AppendLods(mesh, lod_levels, index_offset, &material_id);
+
+        vertex_offset += mesh.m_vertecies.size();
+        triangle_offset += mesh.m_triangles.size();
+    }
+
+    BuildMerged(std::move(combined_triangles), min_bounds, max_bounds, lod_levels);
+}
+
+void Octree::BuildMerged(std::vector<glm::uvec4>&& triangles, glm::vec3 min_bounds, glm::vec3 max_bounds, const std::vector<std::vector<glm::uvec4>>& lod_levels) {
+    size_t triangle_count = triangles.size();
+
+    if (m_vertecies.empty()) {
+        // an empty tree (while the scene is loading) gets a degenerate root at the origin, infinite bounds would make every ray enter it
+        min_bounds = glm::vec3{0.0f};
+        max_bounds = glm::vec3{0.0f};
+    }
+
+    Build(std::move(triangles), AABB{min_bounds, max_bounds}, lod_levels);
 
 
     std::vector<std::vector<size_t>> triangles_per_level;
@@ -279,10 +536,11 @@ Octree::Octree(std::vector<Mesh> meshes, size_t depth_limit, size_t max_triangle
     std::cout << "average leaf depth: " << Average(leaf_depths) << std::endl;
     std::cout << "............................................................." << std::endl;
     std::cout << "vertecies count: " << m_vertecies.size() << std::endl;
-    std::cout << "triangle count: " << combined_triangles.size() << std::endl;
+    std::cout << "triangle count: " << triangle_count << std::endl;
+    std::cout << "lod levels: " << lod_levels.size() << std::endl;
     std::cout << "vertecies size: " << SizeToString(m_vertecies.size() * 16) << std::endl;
     std::cout << "normals size: " << SizeToString(m_normals.size() * 16) << std::endl;
-    std::cout << "uncompressed triangle size: " << SizeToString(combined_triangles.size() * 16) << std::endl;
+    std::cout << "uncompressed triangle size: " << SizeToString(triangle_count * 16) << std::endl;
     std::cout << "............................................................." << std::endl;
     std::cout << "compressed node size: " << SizeToString(m_compressed_node_buffer.size() * 4) << std::endl;
     std::cout << "compresed triangle size: " << SizeToString(m_compressed_triangles.size() * 4) << std::endl;
@@ -290,8 +548,945 @@ Octree::Octree(std::vector<Mesh> meshes, size_t depth_limit, size_t max_triangle
 
 }
 
+// triangles that wait on the disk between the passes of the streaming build, the file is removed when the object is destroyed
+class TriangleSpillFile {
+public:
+    TriangleSpillFile();
+    ~TriangleSpillFile();
+
+    void Write(const glm::uvec4& triangle);
+    void FinishWriting();
+    // calls function(triangles, count) on consecutive blocks of the file
+    template <typename F>
+    void ReadBlocks(F&& function);
+
+    size_t GetCount() const;
+
+private:
+    std::filesystem::path m_path;
+    std::ofstream m_stream;
+    std::vector<glm::uvec4> m_block;
+    size_t m_count;
+};
+
+constexpr size_t SPILL_BLOCK_SIZE = 1 << 14; // in triangles
+constexpr size_t STREAM_WINDOW_SIZE = 1 << 26; // in bytes
+
+TriangleSpillFile::TriangleSpillFile() : m_count{0} {
+    static std::atomic<size_t> file_counter{0};
+
+    std::string name = "octree_spill_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_" + std::to_string(file_counter++);
+    m_path = std::filesystem::temp_directory_path() / name;
+
+    m_stream.open(m_path, std::ios::binary | std::ios::trunc);
+    if (!m_stream) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: couldn't create temporary file %s", m_path.string().c_str());
+        exit(1);
+    }
+    m_block.reserve(SPILL_BLOCK_SIZE);
+}
+
+TriangleSpillFile::~TriangleSpillFile() {
+    m_stream.close();
+    std::error_code ec;
+    std::filesystem::remove(m_path, ec);
+}
+
+void TriangleSpillFile::Write(const glm::uvec4& triangle) {
+    m_block.push_back(triangle);
+    m_count++;
+
+    if (m_block.size() == SPILL_BLOCK_SIZE) {
+        m_stream.write(reinterpret_cast<const char*>(m_block.data()), m_block.size() * sizeof(glm::uvec4));
+        m_block.clear();
+    }
+}
+
+void TriangleSpillFile::FinishWriting() {
+    m_stream.write(reinterpret_cast<const char*>(m_block.data()), m_block.size() * sizeof(glm::uvec4));
+    m_stream.close();
+    std::vector<glm::uvec4>{}.swap(m_block);
+
+    if (m_stream.fail()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: couldn't write temporary file %s (is the disk full?)", m_path.string().c_str());
+        exit(1);
+    }
+}
+
+template <typename F>
+void TriangleSpillFile::ReadBlocks(F&& function) {
+    std::ifstream stream{m_path, std::ios::binary};
+    std::vector<glm::uvec4> block(SPILL_BLOCK_SIZE);
+
+    for (size_t read_count = 0; read_count < m_count; ) {
+        size_t block_count = std::min(SPILL_BLOCK_SIZE, m_count - read_count);
+        stream.read(reinterpret_cast<char*>(block.data()), block_count * sizeof(glm::uvec4));
+        if (!stream) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: couldn't read temporary file %s", m_path.string().c_str());
+            exit(1);
+        }
+
+        function(block.data(), block_count);
+        read_count += block_count;
+    }
+}
+
+size_t TriangleSpillFile::GetCount() const {
+    return m_count;
+}
+
+void Octree::StreamObjFile(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform, TriangleSpillFile& triangles) {
+    try {
+        // the vertecies of every window are converted right away (the same way as in Mesh) and the faces go straight to the spill file,
+        // so the parser never holds a second copy of the vertex data
+        ObjParser::parseStreamed(filename, STREAM_WINDOW_SIZE, [this, &transform](const std::vector<Vertex>& vertecies) {
+            size_t window_start = m_vertecies.size();
+            m_vertecies.resize(window_start + vertecies.size());
+            m_normals.resize(window_start + vertecies.size());
+            ThreadPool::Shared().ParallelFor(vertecies.size(), MERGE_CHUNK_SIZE, [this, &vertecies, &transform, window_start](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    m_vertecies[window_start + i] = glm::vec4{vertecies[i].position, 0.0f};
+                    m_normals[window_start + i] = glm::vec4{vertecies[i].normal, 0.0f};
+                }
+                TransformVertecies(transform, m_vertecies.data() + window_start + begin, m_vertecies.data() + window_start + begin, end - begin);
+            });
+        }, [&triangles, material_id](const std::vector<unsigned int>& indices) {
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                triangles.Write(glm::uvec4(indices[i + 0], indices[i + 1], indices[i + 2], static_cast<GLuint>(material_id)));
+            }
+        }, [this](unsigned int vertex, const glm::vec3& normal) {
+            m_normals[vertex] = glm::vec4{normal, 0.0f};
+        });
+    } catch (ObjParser::Exception exception) {
+        if (exception == ObjParser::EXC_FORWARDREFERENCE) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: %s uses vertecies before they are defined, it can't be streamed", filename.string().c_str());
+        } else {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: couldn't open %s", filename.string().c_str());
+        }
+        exit(1);
+    }
+    triangles.FinishWriting();
+}
+
+void Octree::StreamBuild(const AABB& bounds, TriangleSpillFile& triangles, size_t max_triangles_in_memory, size_t current_depth, size_t parent_node_child_pointer_location) {
+    m_max_depth = std::max(m_max_depth, current_depth);
+
+    if (current_depth >= m_depth_limit) {
+        // the cell can't be split anymore, so it would be a single leaf no matter how many triangles it has, instead of reading them
+        // into a node they are appended to the compressed triangles block by block (written the same way as DepthFirstCompress writes a leaf)
+        if (parent_node_child_pointer_location != 0) {
+            m_compressed_node_buffer[parent_node_child_pointer_location] = static_cast<uint32_t>(m_compressed_node_buffer.size());
+        }
+
+        uint16_t triangle_count = static_cast<uint16_t>(triangles.GetCount());
+        uint32_t node_info = (triangle_count << 16);
+        uint32_t triangle_start = static_cast<uint32_t>(m_compressed_triangles.size());
+
+        triangles.ReadBlocks([this](const glm::uvec4* block, size_t count) {
+            m_compressed_triangles.insert(m_compressed_triangles.end(), block, block + count);
+        });
+
+        m_compressed_node_buffer.push_back(node_info);
+        m_compressed_node_buffer.push_back(triangle_start);
+        return;
+    }
+
+    if (triangles.GetCount() <= max_triangles_in_memory) {
+        std::vector<glm::uvec4> node_triangles{};
+        node_triangles.reserve(triangles.GetCount());
+        triangles.ReadBlocks([&node_triangles](const glm::uvec4* block, size_t count) {
+            node_triangles.insert(node_triangles.end(), block, block + count);
+        });
+
+        // the subtree is built like in memory and freed as soon as it is compressed
+        std::unique_ptr<OctreeNode> node = std::make_unique<OctreeNode>(OctreeNode{bounds, std::move(node_triangles), {}, true});
+        Subdivide(node, current_depth);
+        DepthFirstCompress(node, parent_node_child_pointer_location);
+        return;
+    }
+
+    glm::vec3 mid_point{(bounds.min_bounds + bounds.max_bounds) / 2.0f};
+
+    std::array<AABB, 8> childrens_bounds;
+    std::array<std::unique_ptr<TriangleSpillFile>, 8> childrens_triangles;
+    for (size_t i = 0; i < 8; i++) {
+        childrens_bounds[i] = AABB{
+            glm::vec3{(i & 1) ? mid_point.x : bounds.min_bounds.x, (i & 2) ? mid_point.y : bounds.min_bounds.y, (i & 4) ? mid_point.z : bounds.min_bounds.z},
+            glm::vec3{(i & 1) ? bounds.max_bounds.x : mid_point.x, (i & 2) ? bounds.max_bounds.y : mid_point.y, (i & 4) ? bounds.max_bounds.z : mid_point.z}
+        };
+        childrens_triangles[i] = std::make_unique<TriangleSpillFile>();
+    }
+
+    // same rule as in Subdivide, except that the node keeps the first triangles that qualify instead of the ones with the most overlaps
+    std::vector<glm::uvec4> kept_triangles{};
+
+    triangles.ReadBlocks([&](const glm::uvec4* block, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const glm::uvec4& ind = block[i];
+            glm::vec3 v1{m_vertecies[ind.x].x, m_vertecies[ind.x].y, m_vertecies[ind.x].z};
+            glm::vec3 v2{m_vertecies[ind.y].x, m_vertecies[ind.y].y, m_vertecies[ind.y].z};
+            glm::vec3 v3{m_vertecies[ind.z].x, m_vertecies[ind.z].y, m_vertecies[ind.z].z};
+
+            std::array<size_t, 8> childrens_overlap;
+            size_t overlap_count = 0;
+            for (size_t child_index = 0; child_index < 8; child_index++) {
+                if (AABBTriangleOverlapTest(childrens_bounds[child_index], v1, v2, v3)) {
+                    childrens_overlap[overlap_count] = child_index;
+                    overlap_count++;
+                }
+            }
+
+            if (overlap_count >= m_keep_triangles_after_this_many_overlaps && kept_triangles.size() < m_max_triangles_per_node) {
+                kept_triangles.push_back(ind);
+            } else {
+                for (size_t j = 0; j < overlap_count; j++) {
+                    childrens_triangles[childrens_overlap[j]]->Write(ind);
+                }
+            }
+        }
+    });
+
+    uint8_t children_mask = 0x00;
+    uint8_t children_count = 0;
+    for (size_t i = 0; i < 8; i++) {
+        childrens_triangles[i]->FinishWriting();
+        if (childrens_triangles[i]->GetCount() != 0) {
+            children_mask |= (0x01 << i);
+            children_count++;
+        }
+    }
+
+    // the node is written the same way as in DepthFirstCompress, the children are appended after it one by one
+    if (parent_node_child_pointer_location != 0) {
+        m_compressed_node_buffer[parent_node_child_pointer_location] = static_cast<uint32_t>(m_compressed_node_buffer.size());
+    }
+
+    uint16_t triangle_count = static_cast<uint16_t>(kept_triangles.size());
+    uint32_t node_info = (triangle_count << 16) | (children_mask << 8) | children_count;
+    uint32_t triangle_start = static_cast<uint32_t>(m_compressed_triangles.size());
+
+    m_compressed_triangles.insert(m_compressed_triangles.end(), kept_triangles.cbegin(), kept_triangles.cend());
+
+    m_compressed_node_buffer.push_back(node_info);
+    m_compressed_node_buffer.push_back(triangle_start);
+
+    size_t child_pointers_start = m_compressed_node_buffer.size();
+    m_compressed_node_buffer.resize(child_pointers_start + children_count, 0);
+
+    size_t child_pointer_offset = 0;
+    for (size_t i = 0; i < 8; i++) {
+        if (children_mask & (0x01 << i)) {
+            StreamBuild(childrens_bounds[i], *childrens_triangles[i], max_triangles_in_memory, current_depth + 1, child_pointers_start + child_pointer_offset);
+            child_pointer_offset++;
+        }
+        childrens_triangles[i].reset();
+    }
+}
+
+Octree::Octree(const std::filesystem::path& filename, size_t material_id, glm::mat4 transform, size_t max_triangles_in_memory, size_t depth_limit, size_t max_triangles_per_node, size_t max_triangles_per_leaf, size_t m_keep_triangles_after_this_many_overlaps) : 
+    m_max_depth{0}, 
+    m_depth_limit{depth_limit}, 
+    m_max_triangles_per_node{max_triangles_per_node},
+    m_max_triangles_per_leaf{max_triangles_per_leaf}, 
+    m_keep_triangles_after_this_many_overlaps{m_keep_triangles_after_this_many_overlaps}
+{
+    TriangleSpillFile triangles{};
+    StreamObjFile(filename, material_id, transform, triangles);
+
+    glm::vec3 min_bounds{std::numeric_limits<float>::infinity()};
+    glm::vec3 max_bounds{-1.0f * std::numeric_limits<float>::infinity()};
+
+    std::mutex bounds_mutex;
+    ThreadPool::Shared().ParallelFor(m_vertecies.size(), MERGE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        AABB bounds = CopyAndComputeBounds(m_vertecies.data() + begin, nullptr, end - begin);
+        std::lock_guard<std::mutex> lock{bounds_mutex};
+        min_bounds = glm::min(min_bounds, bounds.min_bounds);
+        max_bounds = glm::max(max_bounds, bounds.max_bounds);
+    });
+
+    if (triangles.GetCount() <= max_triangles_in_memory) {
+        // small enough for the normal build, that keeps the tree so it can be updated later
+        std::vector<glm::uvec4> all_triangles{};
+        all_triangles.reserve(triangles.GetCount());
+        triangles.ReadBlocks([&all_triangles](const glm::uvec4* block, size_t count) {
+            all_triangles.insert(all_triangles.end(), block, block + count);
+        });
+
+        m_meshes.push_back(MeshRecord{0, m_vertecies.size(), true, {}});
+        Build(std::move(all_triangles), AABB{min_bounds, max_bounds});
+    } else {
+        m_is_streamed = true;
+        m_root = std::make_unique<OctreeNode>(OctreeNode{AABB{min_bounds, max_bounds}, {}, {}, true});
+        StreamBuild(AABB{min_bounds, max_bounds}, triangles, max_triangles_in_memory, 1, 0);
+    }
+
+    std::cout << "............................................................." << std::endl;
+    std::cout << "streamed build" << (m_is_streamed ? "" : " (fit in memory)") << std::endl;
+    std::cout << "max depth: " << m_max_depth << std::endl;
+    std::cout << "vertecies count: " << m_vertecies.size() << std::endl;
+    std::cout << "triangle count: " << triangles.GetCount() << std::endl;
+    std::cout << "vertecies size: " << SizeToString(m_vertecies.size() * 16) << std::endl;
+    std::cout << "normals size: " << SizeToString(m_normals.size() * 16) << std::endl;
+    std::cout << "compressed node size: " << SizeToString(m_compressed_node_buffer.size() * 4) << std::endl;
+    std::cout << "compresed triangle size: " << SizeToString(m_compressed_triangles.size() * 4) << std::endl;
+    std::cout << "............................................................." << std::endl;
+}
+
 Octree::~Octree() {}
 
+void Octree::Build(std::vector<glm::uvec4>&& triangles, AABB bounds, const std::vector<std::vector<glm::uvec4>>& lod_levels) {
+    m_max_depth = 0;
+    m_compressed_node_buffer.clear();
+    m_compressed_triangles.clear();
+    m_node_allocator.Clear();
+    m_triangle_allocator.Clear();
+
+    m_root = std::make_unique<OctreeNode>(OctreeNode{bounds, std::move(triangles), {}, true});
+
+    Subdivide(m_root, 1);
+    if (!lod_levels.empty()) {
+        // every triangle of every level is a candidate for the root
+        std::vector<std::vector<uint32_t>> candidates(lod_levels.size());
+        for (size_t level = 0; level < lod_levels.size(); level++) {
+            candidates[level].resize(lod_levels[level].size());
+            std::iota(candidates[level].begin(), candidates[level].end(), 0);
+        }
+        AssignLods(m_root, lod_levels, candidates);
+    }
+    DepthFirstCompress(m_root, 0);
+}
+
+void RemoveDuplicateTriangles(std::vector<glm::uvec4>& triangles) {
+    // triangles that overlap several nodes are stored in each of them
+    std::sort(triangles.begin(), triangles.end(), [](const glm::uvec4& a, const glm::uvec4& b) {
+        return std::tie(a.x, a.y, a.z, a.w) < std::tie(b.x, b.y, b.z, b.w);
+    });
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+}
+
+void Octree::Rebuild(std::vector<glm::uvec4>&& additional_triangles) {
+    std::vector<glm::uvec4> triangles = std::move(additional_triangles);
+    CollectTriangles(m_root, triangles);
+    RemoveDuplicateTriangles(triangles);
+
+    glm::vec3 min_bounds{std::numeric_limits<float>::infinity()};
+    glm::vec3 max_bounds{-1.0f * std::numeric_limits<float>::infinity()};
+
+    for (const MeshRecord& record : m_meshes) {
+        if (record.is_alive) {
+            AABB bounds = CopyAndComputeBounds(m_vertecies.data() + record.vertex_start, nullptr, record.vertex_count);
+            min_bounds = glm::min(min_bounds, bounds.min_bounds);
+            max_bounds = glm::max(max_bounds, bounds.max_bounds);
+        }
+    }
+
+    Build(std::move(triangles), AABB{min_bounds, max_bounds});
+
+    // everything was rewritten so the partial ranges are replaced by the whole buffers
+    m_dirty_ranges.nodes = {DirtyRange{0, m_compressed_node_buffer.size() * sizeof(decltype(m_compressed_node_buffer)::value_type)}};
+    m_dirty_ranges.triangles = {DirtyRange{0, m_compressed_triangles.size() * sizeof(decltype(m_compressed_triangles)::value_type)}};
+}
+
+AABB Octree::ComputeMeshBounds(const MeshRecord& record) {
+    return CopyAndComputeBounds(m_vertecies.data() + record.vertex_start, nullptr, record.vertex_count);
+}
+
+bool Octree::CanModifyTree() {
+    if (m_is_streamed) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: a streamed octree can't be updated incrementally");
+        return false;
+    }
+    return true;
+}
+
+bool Octree::IsLiveMesh(MeshHandle handle) {
+    if (handle >= m_meshes.size()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: mesh handle %zu is out of range (%zu meshes)", handle, m_meshes.size());
+        return false;
+    }
+
+    const MeshRecord& record = m_meshes[handle];
+    if (!record.is_alive) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: mesh %zu was already removed", handle);
+        return false;
+    }
+    if (record.vertex_start + record.vertex_count > m_vertecies.size()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: the vertecies of mesh %zu are outside of the vertex buffer", handle);
+        return false;
+    }
+    return true;
+}
+
+bool Octree::IsInsideBounds(const AABB& bounds) {
+    return glm::all(glm::greaterThanEqual(bounds.min_bounds, m_root->bounding_box.min_bounds)) && glm::all(glm::lessThanEqual(bounds.max_bounds, m_root->bounding_box.max_bounds));
+}
+
+bool Octree::InsertTriangle(std::unique_ptr<OctreeNode>& node, const glm::uvec4& triangle, size_t current_depth) {
+    if (node->is_leaf) {
+        node->triangles.push_back(triangle);
+        node->triangles_changed = true;
+
+        if (node->triangles.size() > m_max_triangles_per_leaf) {
+            Subdivide(node, current_depth);
+        }
+        return true;
+    }
+
+    glm::vec3 v1{m_vertecies[triangle.x].x, m_vertecies[triangle.x].y, m_vertecies[triangle.x].z};
+    glm::vec3 v2{m_vertecies[triangle.y].x, m_vertecies[triangle.y].y, m_vertecies[triangle.y].z};
+    glm::vec3 v3{m_vertecies[triangle.z].x, m_vertecies[triangle.z].y, m_vertecies[triangle.z].z};
+
+    std::array<size_t, 8> childrens_overlap;
+    size_t overlap_count = 0;
+    for (size_t child_index = 0; child_index < 8; child_index++) {
+        if (AABBTriangleOverlapTest(node->childrens[child_index]->bounding_box, v1, v2, v3)) {
+            childrens_overlap[overlap_count] = child_index;
+            overlap_count++;
+        }
+    }
+
+    // same rule as in Subdivide, except that the node keeps the first triangles that qualify instead of the ones with the most overlaps
+    if (overlap_count >= m_keep_triangles_after_this_many_overlaps && node->triangles.size() < m_max_triangles_per_node) {
+        node->triangles.push_back(triangle);
+        node->triangles_changed = true;
+        return true;
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < overlap_count; i++) {
+        changed |= InsertTriangle(node->childrens[childrens_overlap[i]], triangle, current_depth + 1);
+    }
+    node->subtree_changed |= changed;
+
+    return changed;
+}
+
+bool AABBOverlapTest(const AABB& a, const AABB& b) {
+    return !(glm::any(glm::lessThan(a.max_bounds, b.min_bounds)) || glm::any(glm::greaterThan(a.min_bounds, b.max_bounds)));
+}
+
+AABB TriangleBounds(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3) {
+    return AABB{glm::min(glm::min(v1, v2), v3), glm::max(glm::max(v1, v2), v3)};
+}
+
+bool Octree::RemoveTriangles(std::unique_ptr<OctreeNode>& node, const AABB& mesh_bounds, size_t vertex_start, size_t vertex_end, std::vector<glm::uvec4>& removed_triangles) {
+    // the mesh can only have triangles in the nodes its bounding box overlaps
+    if (!AABBOverlapTest(node->bounding_box, mesh_bounds)) {
+        return false;
+    }
+
+    auto belongs_to_mesh = [vertex_start, vertex_end](const glm::uvec4& ind) {
+        return ind.x >= vertex_start && ind.x < vertex_end;
+    };
+
+    bool changed = false;
+
+    auto removed_start = std::stable_partition(node->triangles.begin(), node->triangles.end(), [&belongs_to_mesh](const glm::uvec4& ind) { return !belongs_to_mesh(ind); });
+    if (removed_start != node->triangles.end()) {
+        removed_triangles.insert(removed_triangles.end(), removed_start, node->triangles.end());
+        node->triangles.erase(removed_start, node->triangles.end());
+        node->triangles_changed = true;
+        changed = true;
+    }
+
+    // the levels of detail index the same vertecies, so the ones of the mesh have to go as well (they aren't reinserted, they only
+    // approximate the full detail triangles), the node is rewritten without them
+    auto removed_lod_start = std::remove_if(node->lod_triangles.begin(), node->lod_triangles.end(), belongs_to_mesh);
+    if (removed_lod_start != node->lod_triangles.end()) {
+        node->lod_triangles.erase(removed_lod_start, node->lod_triangles.end());
+        node->triangles_changed = true;
+        changed = true;
+    }
+
+    if (!node->is_leaf) {
+        for (size_t i = 0; i < 8; i++) {
+            if (RemoveTriangles(node->childrens[i], mesh_bounds, vertex_start, vertex_end, removed_triangles)) {
+                node->subtree_changed = true;
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+// returns the number of full detail triangles in the subtree, a level of detail is only kept where it saves at least half of them
+size_t Octree::AssignLods(std::unique_ptr<OctreeNode>& node, const std::vector<std::vector<glm::uvec4>>& lod_levels, const std::vector<std::vector<uint32_t>>& candidates) {
+    if (node->is_leaf) {
+        return node->triangles.size();
+    }
+
+    auto vertex = [this](GLuint index) {
+        return glm::vec3{m_vertecies[index].x, m_vertecies[index].y, m_vertecies[index].z};
+    };
+
+    // only the triangles of the parent that overlap this node can be in it (bounding boxes are enough, a few extra ones don't hurt)
+    bool is_root = (node.get() == m_root.get());
+    std::vector<std::vector<uint32_t>> node_candidates(candidates.size());
+    for (size_t level = 0; level < candidates.size(); level++) {
+        if (is_root) {
+            node_candidates[level] = candidates[level];
+            continue;
+        }
+        std::copy_if(candidates[level].cbegin(), candidates[level].cend(), std::back_inserter(node_candidates[level]), [&](uint32_t i) {
+            const glm::uvec4& triangle = lod_levels[level][i];
+            return AABBOverlapTest(node->bounding_box, TriangleBounds(vertex(triangle.x), vertex(triangle.y), vertex(triangle.z)));
+        });
+    }
+
+    glm::vec3 node_size = node->bounding_box.max_bounds - node->bounding_box.min_bounds;
+    float max_feature_size = std::max({node_size.x, node_size.y, node_size.z}) / LOD_NODE_RESOLUTION;
+
+    // the coarsest level that is detailed enough for the node, the children can only use it or finer ones
+    size_t chosen_level = node_candidates.size();
+    float feature_size = 0.0f;
+    for (size_t level = node_candidates.size(); level-- > 0; ) {
+        if (node_candidates[level].empty()) {
+            continue;
+        }
+
+        double edge_length_sum = 0.0;
+        for (uint32_t i : node_candidates[level]) {
+            const glm::uvec4& triangle = lod_levels[level][i];
+            edge_length_sum += glm::distance(vertex(triangle.x), vertex(triangle.y)) + glm::distance(vertex(triangle.y), vertex(triangle.z)) + glm::distance(vertex(triangle.z), vertex(triangle.x));
+        }
+        float mean_edge_length = static_cast<float>(edge_length_sum / (3.0 * node_candidates[level].size()));
+
+        if (mean_edge_length <= max_feature_size) {
+            chosen_level = level;
+            feature_size = mean_edge_length;
+            break;
+        }
+    }
+    // even the finest level is too coarse, it only gets worse further down
+    node_candidates.resize(chosen_level == node_candidates.size() ? 0 : chosen_level + 1);
+
+    size_t subtree_triangle_count = node->triangles.size();
+    for (size_t i = 0; i < 8; i++) {
+        subtree_triangle_count += AssignLods(node->childrens[i], lod_levels, node_candidates);
+    }
+
+    // the root is always entered anyways
+    if (!is_root && chosen_level < candidates.size()) {
+        const std::vector<uint32_t>& chosen_candidates = node_candidates[chosen_level];
+        if (chosen_candidates.size() * 2 <= subtree_triangle_count) {
+            node->lod_triangles.reserve(chosen_candidates.size());
+            for (uint32_t i : chosen_candidates) {
+                node->lod_triangles.push_back(lod_levels[chosen_level][i]);
+            }
+            node->lod_feature_size = feature_size;
+        }
+    }
+
+    return subtree_triangle_count;
+}
+
+void Octree::CollectTriangles(std::unique_ptr<OctreeNode>& node, std::vector<glm::uvec4>& triangles) {
+    triangles.insert(triangles.end(), node->triangles.cbegin(), node->triangles.cend());
+
+    if (!node->is_leaf) {
+        for (size_t i = 0; i < 8; i++) {
+            CollectTriangles(node->childrens[i], triangles);
+        }
+    }
+}
+
+void Octree::CollectMeshTriangles(std::unique_ptr<OctreeNode>& node, const AABB& mesh_bounds, size_t vertex_start, size_t vertex_end, std::vector<glm::uvec4>& triangles) {
+    if (!AABBOverlapTest(node->bounding_box, mesh_bounds)) {
+        return;
+    }
+
+    std::copy_if(node->triangles.cbegin(), node->triangles.cend(), std::back_inserter(triangles), [vertex_start, vertex_end](const glm::uvec4& ind) {
+        return ind.x >= vertex_start && ind.x < vertex_end;
+    });
+
+    if (!node->is_leaf) {
+        for (size_t i = 0; i < 8; i++) {
+            CollectMeshTriangles(node->childrens[i], mesh_bounds, vertex_start, vertex_end, triangles);
+        }
+    }
+}
+
+bool Octree::RefitTriangle(std::unique_ptr<OctreeNode>& node, const glm::uvec4& triangle, const AABB& previous_bounds, size_t current_depth) {
+    // a triangle kept by a node is never stored further down, and as long as the node still overlaps it, it can stay there
+    if (std::find(node->triangles.cbegin(), node->triangles.cend(), triangle) != node->triangles.cend()) {
+        return false;
+    }
+
+    if (node->is_leaf) {
+        return InsertTriangle(node, triangle, current_depth);
+    }
+
+    glm::vec3 v1{m_vertecies[triangle.x].x, m_vertecies[triangle.x].y, m_vertecies[triangle.x].z};
+    glm::vec3 v2{m_vertecies[triangle.y].x, m_vertecies[triangle.y].y, m_vertecies[triangle.y].z};
+    glm::vec3 v3{m_vertecies[triangle.z].x, m_vertecies[triangle.z].y, m_vertecies[triangle.z].z};
+
+    bool changed = false;
+    for (size_t i = 0; i < 8; i++) {
+        if (AABBTriangleOverlapTest(node->childrens[i]->bounding_box, v1, v2, v3)) {
+            changed |= RefitTriangle(node->childrens[i], triangle, previous_bounds, current_depth + 1);
+        } else {
+            changed |= RemoveTriangle(node->childrens[i], triangle, previous_bounds);
+        }
+    }
+    node->subtree_changed |= changed;
+
+    return changed;
+}
+
+bool Octree::RemoveTriangle(std::unique_ptr<OctreeNode>& node, const glm::uvec4& triangle, const AABB& previous_bounds) {
+    // it could only be stored in the nodes its previous position overlapped
+    if (!AABBOverlapTest(node->bounding_box, previous_bounds)) {
+        return false;
+    }
+
+    auto removed_start = std::remove(node->triangles.begin(), node->triangles.end(), triangle);
+    if (removed_start != node->triangles.end()) {
+        node->triangles.erase(removed_start, node->triangles.end());
+        node->triangles_changed = true;
+        return true;
+    }
+
+    bool changed = false;
+    if (!node->is_leaf) {
+        for (size_t i = 0; i < 8; i++) {
+            changed |= RemoveTriangle(node->childrens[i], triangle, previous_bounds);
+        }
+    }
+    node->subtree_changed |= changed;
+
+    return changed;
+}
+
+void Octree::FreeCompressedNode(OctreeNode& node) {
+    m_node_allocator.Free(node.compressed_node_start, node.compressed_node_capacity);
+    m_triangle_allocator.Free(node.compressed_triangle_start, node.compressed_triangle_capacity);
+    m_triangle_allocator.Free(node.compressed_lod_triangle_start, node.compressed_lod_triangle_capacity);
+    node.compressed_node_capacity = 0;
+    node.compressed_triangle_capacity = 0;
+    node.compressed_lod_triangle_capacity = 0;
+    std::vector<glm::uvec4>{}.swap(node.lod_triangles);
+}
+
+void Octree::RecompressChanged(std::unique_ptr<OctreeNode>& node) {
+    // children first, so their final location is known when this node writes its child pointers
+    uint8_t children_mask = 0x00;
+    uint8_t children_count = 0;
+
+    if (!node->is_leaf) {
+        for (size_t i = 0; i < 8; i++) {
+            std::unique_ptr<OctreeNode>& child = node->childrens[i];
+            if ((!child->is_leaf || child->triangles.size() != 0) && 
+                (child->compressed_node_capacity == 0 || child->triangles_changed || child->subtree_changed)) {
+                RecompressChanged(child); // it can fold into an empty leaf
+            }
+
+            if (!child->is_leaf || child->triangles.size() != 0) {
+                children_mask |= (0x01 << i);
+                children_count++;
+            } else {
+                // nothing points to an empty leaf, its slots are reused until triangles are inserted into it again
+                FreeCompressedNode(*child);
+            }
+        }
+
+        // the removals emptied everything below, so the node is folded back into a leaf (unless Subdivide would split it again)
+        // and the traversal doesn't have to visit the empty cells anymore
+        if (children_count == 0 && node->triangles.size() <= m_max_triangles_per_leaf) {
+            for (std::unique_ptr<OctreeNode>& child : node->childrens) {
+                child.reset();
+            }
+            node->is_leaf = true;
+        }
+    }
+
+    if (node->is_leaf && node->triangles.empty() && node.get() != m_root.get()) {
+        node->triangles_changed = false;
+        node->subtree_changed = false;
+        return; // the parent frees it
+    }
+
+    // the levels of detail would be stale after a change in the subtree, they aren't regenerated for incremental updates
+    if (node->compressed_lod_triangle_capacity != 0) {
+        m_triangle_allocator.Free(node->compressed_lod_triangle_start, node->compressed_lod_triangle_capacity);
+        node->compressed_lod_triangle_capacity = 0;
+        std::vector<glm::uvec4>{}.swap(node->lod_triangles);
+    }
+
+    if (node->triangles_changed || node->compressed_node_capacity == 0) {
+        if (node->triangles.size() > node->compressed_triangle_capacity) {
+            m_triangle_allocator.Free(node->compressed_triangle_start, node->compressed_triangle_capacity);
+
+            // some slack, so the next few insertions can be written in place
+            size_t capacity = std::max(node->triangles.size(), m_max_triangles_per_node);
+            size_t buffer_end = m_compressed_triangles.size();
+            node->compressed_triangle_start = m_triangle_allocator.Allocate(capacity, buffer_end);
+            node->compressed_triangle_capacity = capacity;
+            m_compressed_triangles.resize(buffer_end);
+        }
+
+        std::copy(node->triangles.cbegin(), node->triangles.cend(), m_compressed_triangles.begin() + node->compressed_triangle_start);
+        if (!node->triangles.empty()) {
+            m_dirty_ranges.triangles.push_back(DirtyRange{
+                node->compressed_triangle_start * sizeof(decltype(m_compressed_triangles)::value_type), 
+                node->triangles.size() * sizeof(decltype(m_compressed_triangles)::value_type)
+            });
+        }
+    }
+
+    size_t node_size = 2 + children_count;
+    if (node_size > node->compressed_node_capacity) {
+        m_node_allocator.Free(node->compressed_node_start, node->compressed_node_capacity);
+
+        size_t buffer_end = m_compressed_node_buffer.size();
+        node->compressed_node_start = m_node_allocator.Allocate(node_size, buffer_end);
+        node->compressed_node_capacity = node_size;
+        m_compressed_node_buffer.resize(buffer_end);
+    }
+
+    uint16_t triangle_count = static_cast<uint16_t>(node->triangles.size());
+    uint32_t node_info = (triangle_count << 16) | (children_mask << 8) | children_count;
+
+    m_compressed_node_buffer[node->compressed_node_start + 0] = node_info;
+    m_compressed_node_buffer[node->compressed_node_start + 1] = static_cast<uint32_t>(node->compressed_triangle_start);
+
+    size_t child_pointer_offset = 0;
+    for (size_t i = 0; i < 8; i++) {
+        if (children_mask & (0x01 << i)) {
+            m_compressed_node_buffer[node->compressed_node_start + 2 + child_pointer_offset] = static_cast<uint32_t>(node->childrens[i]->compressed_node_start);
+            child_pointer_offset++;
+        }
+    }
+
+    m_dirty_ranges.nodes.push_back(DirtyRange{
+        node->compressed_node_start * sizeof(decltype(m_compressed_node_buffer)::value_type), 
+        node_size * sizeof(decltype(m_compressed_node_buffer)::value_type)
+    });
+
+    node->triangles_changed = false;
+    node->subtree_changed = false;
+}
+
+void Octree::InsertTriangles(std::vector<glm::uvec4>&& triangles, const AABB& mesh_bounds) {
+    if (!IsInsideBounds(mesh_bounds)) {
+        // the root cell can't grow in place, every node would change anyways
+        Rebuild(std::move(triangles));
+        return;
+    }
+
+    for (const glm::uvec4& triangle : triangles) {
+        InsertTriangle(m_root, triangle, 1);
+    }
+    RecompressChanged(m_root);
+}
+
+void Octree::TransformMeshVertecies(size_t vertex_start, size_t vertex_count, const glm::mat4& transform) {
+    glm::mat3 normal_transform = glm::transpose(glm::inverse(glm::mat3{transform}));
+
+    for (size_t i = vertex_start; i < vertex_start + vertex_count; i++) {
+        glm::vec3 vertex{m_vertecies[i].x, m_vertecies[i].y, m_vertecies[i].z};
+        glm::vec3 normal{m_normals[i].x, m_normals[i].y, m_normals[i].z};
+
+        m_vertecies[i] = glm::vec4{glm::vec3{transform * glm::vec4{vertex, 1.0f}}, m_vertecies[i].w};
+        m_normals[i] = glm::vec4{glm::normalize(normal_transform * normal), 0.0f};
+    }
+}
+
+MeshHandle Octree::Insert(Mesh&& mesh, const glm::mat4& placement) {
+    if (!CanModifyTree()) {
+        return INVALID_MESH_HANDLE;
+    }
+
+    size_t vertex_count = mesh.m_vertecies.size();
+    size_t buffer_end = m_vertecies.size();
+    size_t vertex_start = m_vertex_allocator.Allocate(vertex_count, buffer_end);
+
+    m_vertecies.resize(buffer_end);
+    m_normals.resize(buffer_end);
+
+    std::copy(mesh.m_vertecies.cbegin(), mesh.m_vertecies.cend(), m_vertecies.begin() + vertex_start);
+    std::copy(mesh.m_normals.cbegin(), mesh.m_normals.cend(), m_normals.begin() + vertex_start);
+    if (placement != glm::mat4{1.0f}) {
+        TransformMeshVertecies(vertex_start, vertex_count, placement);
+    }
+
+    m_dirty_ranges.vertecies.push_back(DirtyRange{vertex_start * sizeof(glm::vec4), vertex_count * sizeof(glm::vec4)});
+    m_dirty_ranges.normals.push_back(DirtyRange{vertex_start * sizeof(glm::vec4), vertex_count * sizeof(glm::vec4)});
+
+    MeshHandle handle = m_meshes.size();
+    m_meshes.push_back(MeshRecord{vertex_start, vertex_count, true, {}});
+
+    std::vector<glm::uvec4> triangles(mesh.m_triangles.size());
+    CopyWithIndexOffset(mesh.m_triangles.data(), triangles.data(), triangles.size(), static_cast<GLuint>(vertex_start));
+
+    InsertTriangles(std::move(triangles), ComputeMeshBounds(m_meshes[handle]));
+
+    return handle;
+}
+
+void Octree::Remove(MeshHandle handle) {
+    if (!CanModifyTree() || !IsLiveMesh(handle)) {
+        return;
+    }
+
+    MeshRecord& record = m_meshes[handle];
+
+    std::vector<glm::uvec4> removed_triangles{};
+    RemoveTriangles(m_root, ComputeMeshBounds(record), record.vertex_start, record.vertex_start + record.vertex_count, removed_triangles);
+    RecompressChanged(m_root);
+
+    // the vertecies stay in the buffers until the range is reused, nothing references them anymore
+    m_vertex_allocator.Free(record.vertex_start, record.vertex_count);
+    record.is_alive = false;
+    std::vector<glm::uvec4>{}.swap(record.triangles);
+}
+
+void Octree::Update(MeshHandle handle, const glm::mat4& transform) {
+    if (!CanModifyTree() || !IsLiveMesh(handle)) {
+        return;
+    }
+
+    MeshRecord& record = m_meshes[handle];
+
+    std::vector<glm::uvec4> triangles{};
+    RemoveTriangles(m_root, ComputeMeshBounds(record), record.vertex_start, record.vertex_start + record.vertex_count, triangles);
+    RemoveDuplicateTriangles(triangles);
+
+    TransformMeshVertecies(record.vertex_start, record.vertex_count, transform);
+
+    m_dirty_ranges.vertecies.push_back(DirtyRange{record.vertex_start * sizeof(glm::vec4), record.vertex_count * sizeof(glm::vec4)});
+    m_dirty_ranges.normals.push_back(DirtyRange{record.vertex_start * sizeof(glm::vec4), record.vertex_count * sizeof(glm::vec4)});
+
+    InsertTriangles(std::move(triangles), ComputeMeshBounds(record));
+}
+
+void Octree::Refit(MeshHandle handle, const std::vector<glm::vec4>& vertecies, const std::vector<glm::vec4>& normals) {
+    if (!CanModifyTree() || !IsLiveMesh(handle)) {
+        return;
+    }
+
+    MeshRecord& record = m_meshes[handle];
+    if (vertecies.size() != record.vertex_count || (!normals.empty() && normals.size() != record.vertex_count)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Octree] error: refit needs the same amount of vertecies as the mesh has");
+        return;
+    }
+
+    size_t vertex_start = record.vertex_start;
+    size_t vertex_end = record.vertex_start + record.vertex_count;
+
+    if (record.triangles.empty()) {
+        CollectMeshTriangles(m_root, ComputeMeshBounds(record), vertex_start, vertex_end, record.triangles);
+        RemoveDuplicateTriangles(record.triangles);
+    }
+
+    std::vector<glm::vec4> previous_vertecies(m_vertecies.cbegin() + vertex_start, m_vertecies.cbegin() + vertex_end);
+
+    std::copy(vertecies.cbegin(), vertecies.cend(), m_vertecies.begin() + vertex_start);
+    m_dirty_ranges.vertecies.push_back(DirtyRange{vertex_start * sizeof(glm::vec4), record.vertex_count * sizeof(glm::vec4)});
+
+    if (!normals.empty()) {
+        std::copy(normals.cbegin(), normals.cend(), m_normals.begin() + vertex_start);
+        m_dirty_ranges.normals.push_back(DirtyRange{vertex_start * sizeof(glm::vec4), record.vertex_count * sizeof(glm::vec4)});
+    }
+
+    if (!IsInsideBounds(ComputeMeshBounds(record))) {
+        // the root cell can't grow in place
+        Rebuild({});
+        return;
+    }
+
+    for (const glm::uvec4& triangle : record.triangles) {
+        const glm::vec4& p1 = previous_vertecies[triangle.x - vertex_start];
+        const glm::vec4& p2 = previous_vertecies[triangle.y - vertex_start];
+        const glm::vec4& p3 = previous_vertecies[triangle.z - vertex_start];
+
+        // usually only a part of a deforming mesh moves
+        if (p1 == m_vertecies[triangle.x] && p2 == m_vertecies[triangle.y] && p3 == m_vertecies[triangle.z]) {
+            continue;
+        }
+
+        AABB previous_bounds = TriangleBounds(glm::vec3{p1.x, p1.y, p1.z}, glm::vec3{p2.x, p2.y, p2.z}, glm::vec3{p3.x, p3.y, p3.z});
+        RefitTriangle(m_root, triangle, previous_bounds, 1);
+    }
+    RecompressChanged(m_root);
+}
+
+std::vector<glm::vec4> Octree::GetMeshVertecies(MeshHandle handle) {
+    if (!IsLiveMesh(handle)) {
+        return {};
+    }
+
+    const MeshRecord& record = m_meshes[handle];
+    return std::vector<glm::vec4>(m_vertecies.cbegin() + record.vertex_start, m_vertecies.cbegin() + record.vertex_start + record.vertex_count);
+}
+
+void MergeDirtyRanges(std::vector<DirtyRange>& ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const DirtyRange& a, const DirtyRange& b) { return a.offset < b.offset; });
+
+    std::vector<DirtyRange> merged_ranges{};
+    for (const DirtyRange& range : ranges) {
+        if (!merged_ranges.empty() && range.offset <= merged_ranges.back().offset + merged_ranges.back().size) {
+            size_t end = std::max(merged_ranges.back().offset + merged_ranges.back().size, range.offset + range.size);
+            merged_ranges.back().size = end - merged_ranges.back().offset;
+        } else {
+            merged_ranges.push_back(range);
+        }
+    }
+    ranges = std::move(merged_ranges);
+}
+
+OctreeDirtyRanges Octree::TakeDirtyRanges() {
+    OctreeDirtyRanges dirty_ranges = std::move(m_dirty_ranges);
+    m_dirty_ranges = OctreeDirtyRanges{};
+
+    MergeDirtyRanges(dirty_ranges.vertecies);
+    MergeDirtyRanges(dirty_ranges.normals);
+    MergeDirtyRanges(dirty_ranges.nodes);
+    MergeDirtyRanges(dirty_ranges.triangles);
+
+    return dirty_ranges;
+}
+
+size_t FreeListAllocator::Allocate(size_t size, size_t& buffer_end) {
+    for (auto it = m_free_ranges.begin(); it != m_free_ranges.end(); it++) {
+        if (it->second >= size) {
+            size_t start = it->first;
+            it->first += size;
+            it->second -= size;
+            if (it->second == 0) {
+                m_free_ranges.erase(it);
+            }
+            return start;
+        }
+    }
+
+    size_t start = buffer_end;
+    buffer_end += size;
+    return start;
+}
+
+void FreeListAllocator::Free(size_t start, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    auto it = std::lower_bound(m_free_ranges.begin(), m_free_ranges.end(), std::make_pair(start, size));
+    it = m_free_ranges.insert(it, std::make_pair(start, size));
+
+    if ((it + 1) != m_free_ranges.end() && it->first + it->second == (it + 1)->first) {
+        it->second += (it + 1)->second;
+        m_free_ranges.erase(it + 1);
+    }
+    if (it != m_free_ranges.begin() && (it - 1)->first + (it - 1)->second == it->first) {
+        (it - 1)->second += it->second;
+        m_free_ranges.erase(it);
+    }
+}
+
+void FreeListAllocator::Clear() {
+    m_free_ranges.clear();
+}
+
 glm::vec3 Octree::GetMinBounds() {
     return m_root->bounding_box.min_bounds;
 }
@@ -0,0 +1,377 @@
+#include "PlyFile.hpp"
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+enum class PlyType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, INVALID };
+
+struct PlyProperty {
+    std::string name;
+    PlyType type;
+    bool is_list;
+    PlyType count_type; // only for lists
+    size_t offset; // from the start of the element, only for elements without lists
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+    size_t stride; // 0 if the element has a list property, then every instance has to be walked to find its size
+};
+
+constexpr size_t PLY_DECODE_CHUNK_SIZE = 1 << 14;
+
+PlyType ParsePlyType(const std::string& name) {
+    if (name == "char" || name == "int8") return PlyType::INT8;
+    if (name == "uchar" || name == "uint8") return PlyType::UINT8;
+    if (name == "short" || name == "int16") return PlyType::INT16;
+    if (name == "ushort" || name == "uint16") return PlyType::UINT16;
+    if (name == "int" || name == "int32") return PlyType::INT32;
+    if (name == "uint" || name == "uint32") return PlyType::UINT32;
+    if (name == "float" || name == "float32") return PlyType::FLOAT32;
+    if (name == "double" || name == "float64") return PlyType::FLOAT64;
+    return PlyType::INVALID;
+}
+
+size_t GetPlyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::INT8: case PlyType::UINT8: return 1;
+        case PlyType::INT16: case PlyType::UINT16: return 2;
+        case PlyType::INT32: case PlyType::UINT32: case PlyType::FLOAT32: return 4;
+        case PlyType::FLOAT64: return 8;
+        default: return 0;
+    }
+}
+
+template <typename T>
+T LoadPlyValue(const char* data, bool swap_bytes) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, data, sizeof(T));
+    if (swap_bytes) {
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+double LoadPlyNumber(const char* data, PlyType type, bool swap_bytes) {
+    switch (type) {
+        case PlyType::INT8: return LoadPlyValue<int8_t>(data, swap_bytes);
+        case PlyType::UINT8: return LoadPlyValue<uint8_t>(data, swap_bytes);
+        case PlyType::INT16: return LoadPlyValue<int16_t>(data, swap_bytes);
+        case PlyType::UINT16: return LoadPlyValue<uint16_t>(data, swap_bytes);
+        case PlyType::INT32: return LoadPlyValue<int32_t>(data, swap_bytes);
+        case PlyType::UINT32: return LoadPlyValue<uint32_t>(data, swap_bytes);
+        case PlyType::FLOAT32: return LoadPlyValue<float>(data, swap_bytes);
+        case PlyType::FLOAT64: return LoadPlyValue<double>(data, swap_bytes);
+        default: return 0.0;
+    }
+}
+
+// counts and indecies, negative values become huge so they fail the range checks
+uint64_t LoadPlyInteger(const char* data, PlyType type, bool swap_bytes) {
+    switch (type) {
+        case PlyType::INT8: return static_cast<uint64_t>(static_cast<int64_t>(LoadPlyValue<int8_t>(data, swap_bytes)));
+        case PlyType::UINT8: return LoadPlyValue<uint8_t>(data, swap_bytes);
+        case PlyType::INT16: return static_cast<uint64_t>(static_cast<int64_t>(LoadPlyValue<int16_t>(data, swap_bytes)));
+        case PlyType::UINT16: return LoadPlyValue<uint16_t>(data, swap_bytes);
+        case PlyType::INT32: return static_cast<uint64_t>(static_cast<int64_t>(LoadPlyValue<int32_t>(data, swap_bytes)));
+        case PlyType::UINT32: return LoadPlyValue<uint32_t>(data, swap_bytes);
+        default: return static_cast<uint64_t>(LoadPlyNumber(data, type, swap_bytes));
+    }
+}
+
+bool ReadPlyHeader(const char* data, size_t size, bool& is_big_endian, size_t& header_size, std::vector<PlyElement>& elements, std::string& error) {
+    const char END_HEADER[] = "end_header";
+    const char* header_end = std::search(data, data + size, END_HEADER, END_HEADER + sizeof(END_HEADER) - 1);
+    const char* line_end = std::find(header_end, data + size, '\n');
+    if (size < 4 || std::memcmp(data, "ply", 3) != 0 || line_end == data + size) {
+        error = "it is not a ply file";
+        return false;
+    }
+    header_size = static_cast<size_t>(line_end + 1 - data);
+
+    bool has_format = false;
+    std::istringstream header{std::string{data, header_end}};
+    std::string line;
+    std::getline(header, line); // ply
+    while (std::getline(header, line)) {
+        std::istringstream words{line};
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format == "ascii") {
+                error = "ascii ply files are not supported";
+                return false;
+            } else if (format != "binary_little_endian" && format != "binary_big_endian") {
+                error = "unknown format " + format;
+                return false;
+            }
+            is_big_endian = (format == "binary_big_endian");
+            has_format = true;
+        } else if (keyword == "element") {
+            PlyElement element{};
+            words >> element.name >> element.count;
+            if (!words) {
+                error = "invalid element line: " + line;
+                return false;
+            }
+            elements.push_back(element);
+        } else if (keyword == "property") {
+            if (elements.empty()) {
+                error = "property before the first element";
+                return false;
+            }
+            PlyProperty property{};
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string count_type;
+                words >> count_type >> type;
+                property.is_list = true;
+                property.count_type = ParsePlyType(count_type);
+            }
+            property.type = ParsePlyType(type);
+            words >> property.name;
+            if (!words || property.type == PlyType::INVALID || (property.is_list && property.count_type == PlyType::INVALID)) {
+                error = "invalid property line: " + line;
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        }
+        // comment and obj_info lines are ignored
+    }
+
+    if (!has_format) {
+        error = "the format line is missing";
+        return false;
+    }
+
+    for (PlyElement& element : elements) {
+        size_t offset = 0;
+        for (PlyProperty& property : element.properties) {
+            property.offset = offset;
+            offset += GetPlyTypeSize(property.type);
+        }
+        bool has_list = std::any_of(element.properties.cbegin(), element.properties.cend(), [](const PlyProperty& property) { return property.is_list; });
+        element.stride = has_list ? 0 : offset;
+    }
+
+    return true;
+}
+
+// these return the end of the skipped data or nullptr if it doesn't fit before end
+const char* SkipPlyProperty(const char* data, const char* end, const PlyProperty& property, bool swap_bytes) {
+    uint64_t count = 1;
+    if (property.is_list) {
+        size_t count_size = GetPlyTypeSize(property.count_type);
+        if (static_cast<size_t>(end - data) < count_size) {
+            return nullptr;
+        }
+        count = LoadPlyInteger(data, property.count_type, swap_bytes);
+        data += count_size;
+    }
+    if (static_cast<size_t>(end - data) / GetPlyTypeSize(property.type) < count) {
+        return nullptr;
+    }
+    return data + count * GetPlyTypeSize(property.type);
+}
+
+const char* SkipPlyInstance(const char* data, const char* end, const PlyElement& element, bool swap_bytes) {
+    for (const PlyProperty& property : element.properties) {
+        data = SkipPlyProperty(data, end, property, swap_bytes);
+        if (data == nullptr) {
+            return nullptr;
+        }
+    }
+    return data;
+}
+
+const PlyProperty* FindPlyProperty(const PlyElement& element, const char* name) {
+    auto it = std::find_if(element.properties.cbegin(), element.properties.cend(), [name](const PlyProperty& property) { return property.name == name; });
+    return (it == element.properties.cend()) ? nullptr : &(*it);
+}
+
+// the 3 properties are consecutive floats in the byte order of the host (assumed to be little endian, same as for the mesh files)
+bool IsPackedFloat3(const PlyProperty* x, const PlyProperty* y, const PlyProperty* z, bool swap_bytes) {
+    return !swap_bytes && 
+        x->type == PlyType::FLOAT32 && y->type == PlyType::FLOAT32 && z->type == PlyType::FLOAT32 && 
+        y->offset == x->offset + 4 && z->offset == x->offset + 8;
+}
+
+const char* ReadPlyVertecies(const char* data, const char* end, const PlyElement& element, bool swap_bytes, std::vector<glm::vec4>& vertecies, std::vector<glm::vec4>& normals, std::string& error) {
+    const PlyProperty* x = FindPlyProperty(element, "x");
+    const PlyProperty* y = FindPlyProperty(element, "y");
+    const PlyProperty* z = FindPlyProperty(element, "z");
+    const PlyProperty* nx = FindPlyProperty(element, "nx");
+    const PlyProperty* ny = FindPlyProperty(element, "ny");
+    const PlyProperty* nz = FindPlyProperty(element, "nz");
+    if (x == nullptr || y == nullptr || z == nullptr) {
+        error = "the vertex element has no x, y and z properties";
+        return nullptr;
+    }
+    if (element.stride == 0) {
+        error = "list properties on the vertex element are not supported";
+        return nullptr;
+    }
+    if (static_cast<size_t>(end - data) / element.stride < element.count) {
+        error = "the file is truncated";
+        return nullptr;
+    }
+
+    bool has_normals = (nx != nullptr && ny != nullptr && nz != nullptr);
+    bool packed_positions = IsPackedFloat3(x, y, z, swap_bytes);
+    bool packed_normals = has_normals && IsPackedFloat3(nx, ny, nz, swap_bytes);
+
+    // w stays 0, same as for obj files
+    vertecies.resize(element.count, glm::vec4{0.0f});
+    normals.resize(has_normals ? element.count : 0, glm::vec4{0.0f});
+
+    // every vertex has the same size so they are decoded in parallel straight from the file
+    ThreadPool::Shared().ParallelFor(element.count, PLY_DECODE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const char* vertex = data + i * element.stride;
+            if (packed_positions) {
+                std::memcpy(&vertecies[i].x, vertex + x->offset, 3 * sizeof(float));
+            } else {
+                vertecies[i].x = static_cast<float>(LoadPlyNumber(vertex + x->offset, x->type, swap_bytes));
+                vertecies[i].y = static_cast<float>(LoadPlyNumber(vertex + y->offset, y->type, swap_bytes));
+                vertecies[i].z = static_cast<float>(LoadPlyNumber(vertex + z->offset, z->type, swap_bytes));
+            }
+
+            if (packed_normals) {
+                std::memcpy(&normals[i].x, vertex + nx->offset, 3 * sizeof(float));
+            } else if (has_normals) {
+                normals[i].x = static_cast<float>(LoadPlyNumber(vertex + nx->offset, nx->type, swap_bytes));
+                normals[i].y = static_cast<float>(LoadPlyNumber(vertex + ny->offset, ny->type, swap_bytes));
+                normals[i].z = static_cast<float>(LoadPlyNumber(vertex + nz->offset, nz->type, swap_bytes));
+            }
+        }
+    });
+
+    return data + element.count * element.stride;
+}
+
+const char* ReadPlyFaces(const char* data, const char* end, const PlyElement& element, bool swap_bytes, GLuint material_id, std::vector<glm::uvec4>& triangles, std::string& error) {
+    const PlyProperty* indecies = FindPlyProperty(element, "vertex_indices");
+    if (indecies == nullptr) {
+        indecies = FindPlyProperty(element, "vertex_index");
+    }
+    if (indecies == nullptr || !indecies->is_list) {
+        error = "the face element has no vertex_indices list";
+        return nullptr;
+    }
+
+    size_t index_size = GetPlyTypeSize(indecies->type);
+    size_t count_size = GetPlyTypeSize(indecies->count_type);
+    bool packed_indecies = !swap_bytes && (indecies->type == PlyType::INT32 || indecies->type == PlyType::UINT32);
+
+    triangles.reserve(triangles.size() + element.count);
+    for (size_t f = 0; f < element.count; f++) {
+        for (const PlyProperty& property : element.properties) {
+            if (&property != indecies) {
+                data = SkipPlyProperty(data, end, property, swap_bytes);
+                if (data == nullptr) {
+                    error = "the file is truncated";
+                    return nullptr;
+                }
+                continue;
+            }
+
+            if (static_cast<size_t>(end - data) < count_size) {
+                error = "the file is truncated";
+                return nullptr;
+            }
+            uint64_t count = LoadPlyInteger(data, indecies->count_type, swap_bytes);
+            data += count_size;
+            if (static_cast<size_t>(end - data) / index_size < count) {
+                error = "the file is truncated";
+                return nullptr;
+            }
+
+            if (count == 3 && packed_indecies) {
+                // the common case of the scanned models, the triangle is copied as it is
+                glm::uvec4 triangle{0, 0, 0, material_id};
+                std::memcpy(&triangle.x, data, 3 * sizeof(uint32_t));
+                triangles.push_back(triangle);
+            } else if (count >= 3) {
+                GLuint first = static_cast<GLuint>(LoadPlyInteger(data, indecies->type, swap_bytes));
+                GLuint previous = static_cast<GLuint>(LoadPlyInteger(data + index_size, indecies->type, swap_bytes));
+                for (uint64_t i = 2; i < count; i++) {
+                    GLuint current = static_cast<GLuint>(LoadPlyInteger(data + i * index_size, indecies->type, swap_bytes));
+                    triangles.push_back(glm::uvec4{first, previous, current, material_id});
+                    previous = current;
+                }
+            }
+            data += count * index_size;
+        }
+    }
+
+    return data;
+}
+
+bool ReadPlyFile(const char* data, size_t size, std::vector<glm::vec4>& vertecies, std::vector<glm::vec4>& normals, std::vector<glm::uvec4>& triangles, GLuint material_id, std::string& error) {
+    bool is_big_endian = false;
+    size_t header_size = 0;
+    std::vector<PlyElement> elements{};
+    if (!ReadPlyHeader(data, size, is_big_endian, header_size, elements, error)) {
+        return false;
+    }
+
+    // the elements are stored one after the other in the order of the header, each one is decoded in a single pass over the file
+    const char* end = data + size;
+    const char* current = data + header_size;
+    bool has_vertecies = false;
+    for (const PlyElement& element : elements) {
+        if (element.name == "vertex") {
+            current = ReadPlyVertecies(current, end, element, is_big_endian, vertecies, normals, error);
+            has_vertecies = true;
+        } else if (element.name == "face") {
+            current = ReadPlyFaces(current, end, element, is_big_endian, material_id, triangles, error);
+        } else if (element.stride != 0) {
+            if (static_cast<size_t>(end - current) / element.stride < element.count) {
+                current = nullptr;
+                error = "the file is truncated";
+            } else {
+                current += element.count * element.stride;
+            }
+        } else {
+            for (size_t i = 0; i < element.count && current != nullptr; i++) {
+                current = SkipPlyInstance(current, end, element, is_big_endian);
+            }
+            if (current == nullptr) {
+                error = "the file is truncated";
+            }
+        }
+
+        if (current == nullptr) {
+            return false;
+        }
+    }
+
+    if (!has_vertecies) {
+        error = "the file has no vertex element";
+        return false;
+    }
+
+    // the faces can come before the vertecies, so the indecies are only checked at the end
+    GLuint vertex_count = static_cast<GLuint>(vertecies.size());
+    bool indecies_in_range = std::all_of(triangles.cbegin(), triangles.cend(), [vertex_count](const glm::uvec4& triangle) {
+        return triangle.x < vertex_count && triangle.y < vertex_count && triangle.z < vertex_count;
+    });
+    if (!indecies_in_range) {
+        error = "a face references a vertex that doesn't exist";
+        return false;
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "Reprojection.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// has to match reproject.comp
+constexpr GLuint REPROJECT_TILE_SIZE = 8;
+
+void CopyTexture(Texture2D& source, Texture2D& destination, GLsizei width, GLsizei height) {
+    glCopyImageSubData(source.GetTextureID(), GL_TEXTURE_2D, 0, 0, 0, 0, destination.GetTextureID(), GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1);
+}
+
+Reprojection::Reprojection(GLsizei width, GLsizei height) :
+    m_width{width},
+    m_height{height},
+    m_reproject_shader{"assets/reproject.comp"},
+    // the same formats as in the framebuffer so they can be copied
+    m_history_accumulation_texture{width, height, GL_RGBA32F},
+    m_history_variance_texture{width, height, GL_RGBA32F},
+    m_history_normal_depth_texture{width, height, GL_RGBA16F}
+{
+}
+
+void Reprojection::Resize(GLsizei width, GLsizei height) {
+    m_width = width;
+    m_height = height;
+
+    m_history_accumulation_texture.Resize(width, height);
+    m_history_variance_texture.Resize(width, height);
+    m_history_normal_depth_texture.Resize(width, height);
+}
+
+void Reprojection::SaveHistory(Framebuffer& framebuffer) {
+    // the previous frame wrote them as images
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    CopyTexture(framebuffer.GetAccumulationTexture(), m_history_accumulation_texture, m_width, m_height);
+    CopyTexture(framebuffer.GetVarianceTexture(), m_history_variance_texture, m_width, m_height);
+    CopyTexture(framebuffer.GetNormalDepthTexture(), m_history_normal_depth_texture, m_width, m_height);
+}
+
+void Reprojection::Reproject(const glm::mat4& previous_view_proj, const glm::vec3& previous_camera_position, GLuint history_limit) {
+    // the new samples and guides are read
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    m_history_accumulation_texture.BindTexture(1);
+    m_history_variance_texture.BindTexture(2);
+    m_history_normal_depth_texture.BindTexture(3);
+
+    m_reproject_shader.Use();
+    glUniformMatrix4fv(m_reproject_shader.ul("previous_view_proj_mat"), 1, GL_FALSE, glm::value_ptr(previous_view_proj));
+    glUniform3fv(m_reproject_shader.ul("previous_camera_position"), 1, glm::value_ptr(previous_camera_position));
+    glUniform1f(m_reproject_shader.ul("history_limit"), static_cast<GLfloat>(history_limit));
+
+    glDispatchCompute((static_cast<GLuint>(m_width) + REPROJECT_TILE_SIZE - 1) / REPROJECT_TILE_SIZE, (static_cast<GLuint>(m_height) + REPROJECT_TILE_SIZE - 1) / REPROJECT_TILE_SIZE, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "RingBuffer.hpp"
+
+RingBuffer::RingBuffer(GLsizeiptr slot_size, size_t slot_count) : m_slot_count{slot_count}, m_current_slot{slot_count - 1}, m_fences(slot_count, nullptr) {
+    GLint offset_alignment = 1;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+    m_slot_size = (slot_size + offset_alignment - 1) / offset_alignment * offset_alignment;
+
+    // coherent, so the writes don't have to be flushed
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &m_buffer_id);
+    glNamedBufferStorage(m_buffer_id, m_slot_size * static_cast<GLsizeiptr>(slot_count), nullptr, flags);
+    m_mapped_data = static_cast<char*>(glMapNamedBufferRange(m_buffer_id, 0, m_slot_size * static_cast<GLsizeiptr>(slot_count), flags));
+}
+
+RingBuffer::~RingBuffer() {
+    for (GLsync fence : m_fences) {
+        glDeleteSync(fence);
+    }
+
+    glUnmapNamedBuffer(m_buffer_id);
+    glDeleteBuffers(1, &m_buffer_id);
+}
+
+void* RingBuffer::MapNextSlot() {
+    m_current_slot = (m_current_slot + 1) % m_slot_count;
+
+    GLsync& fence = m_fences[m_current_slot];
+    if (fence != nullptr) {
+        // the timeout is in nanoseconds, a second is plenty for a frame
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    return m_mapped_data + m_slot_size * static_cast<GLsizeiptr>(m_current_slot);
+}
+
+void RingBuffer::BindUniform(GLuint index) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, index, m_buffer_id, m_slot_size * static_cast<GLsizeiptr>(m_current_slot), m_slot_size);
+}
+
+void RingBuffer::FenceCurrentSlot() {
+    m_fences[m_current_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "ScenePrimitives.hpp"
+
+#include <array>
+
+// center and radius
+constexpr std::array<std::array<float, 4>, 84> SCENE_SPHERES = {{
+    {0.000000f, -1003.000000f, 0.000000f, 1000.000000f},
+    {-7.995381f, 0.200000f, -7.478668f, 0.200000f},
+    {-7.696819f, 0.200000f, -5.468978f, 0.200000f},
+    {-7.824804f, 0.200000f, -3.120637f, 0.200000f},
+    {-7.132909f, 0.200000f, -1.701323f, 0.200000f},
+    {-7.569523f, 0.200000f, 0.494554f, 0.200000f},
+    {-7.730332f, 0.200000f, 2.358976f, 0.200000f},
+    {-7.892865f, 0.200000f, 4.753728f, 0.200000f},
+    {-7.656691f, 0.200000f, 6.888913f, 0.200000f},
+    {-7.217835f, 0.200000f, 8.203466f, 0.200000f},
+    {-5.115232f, 0.200000f, -7.980404f, 0.200000f},
+    {-5.323222f, 0.200000f, -5.113037f, 0.200000f},
+    {-5.410681f, 0.200000f, -3.527741f, 0.200000f},
+    {-5.460670f, 0.200000f, -1.166543f, 0.200000f},
+    {-5.457659f, 0.200000f, 0.363870f, 0.200000f},
+    {-5.798715f, 0.200000f, 2.161684f, 0.200000f},
+    {-5.116586f, 0.200000f, 4.470188f, 0.200000f},
+    {-5.273591f, 0.200000f, 6.795187f, 0.200000f},
+    {-5.120286f, 0.200000f, 8.731398f, 0.200000f},
+    {-3.601565f, 0.200000f, -7.895600f, 0.200000f},
+    {-3.735860f, 0.200000f, -5.163056f, 0.200000f},
+    {-3.481116f, 0.200000f, -3.794556f, 0.200000f},
+    {-3.866858f, 0.200000f, -1.465965f, 0.200000f},
+    {-3.168870f, 0.200000f, 0.553099f, 0.200000f},
+    {-3.428552f, 0.200000f, 2.627547f, 0.200000f},
+    {-3.771736f, 0.200000f, 4.324785f, 0.200000f},
+    {-3.768522f, 0.200000f, 6.384588f, 0.200000f},
+    {-3.286992f, 0.200000f, 8.441148f, 0.200000f},
+    {-1.552127f, 0.200000f, -7.728200f, 0.200000f},
+    {-1.360796f, 0.200000f, -5.346098f, 0.200000f},
+    {-1.287209f, 0.200000f, -3.735321f, 0.200000f},
+    {-1.344859f, 0.200000f, -1.726654f, 0.200000f},
+    {-1.974774f, 0.200000f, 0.183260f, 0.200000f},
+    {-1.542872f, 0.200000f, 2.067868f, 0.200000f},
+    {-1.743856f, 0.200000f, 4.752810f, 0.200000f},
+    {-1.955621f, 0.200000f, 6.493702f, 0.200000f},
+    {-1.350449f, 0.200000f, 8.068503f, 0.200000f},
+    {0.706123f, 0.200000f, -7.116040f, 0.200000f},
+    {0.897766f, 0.200000f, -5.938681f, 0.200000f},
+    {0.744113f, 0.200000f, -3.402960f, 0.200000f},
+    {0.867750f, 0.200000f, -1.311908f, 0.200000f},
+    {0.082480f, 0.200000f, 0.838206f, 0.200000f},
+    {0.649692f, 0.200000f, 2.525103f, 0.200000f},
+    {0.378574f, 0.200000f, 4.055579f, 0.200000f},
+    {0.425844f, 0.200000f, 6.098526f, 0.200000f},
+    {0.261365f, 0.200000f, 8.661150f, 0.200000f},
+    {2.814218f, 0.200000f, -7.751227f, 0.200000f},
+    {2.050073f, 0.200000f, -5.731364f, 0.200000f},
+    {2.020130f, 0.200000f, -3.472627f, 0.200000f},
+    {2.884277f, 0.200000f, -1.232662f, 0.200000f},
+    {2.644454f, 0.200000f, 0.596324f, 0.200000f},
+    {2.194283f, 0.200000f, 2.880603f, 0.200000f},
+    {2.281000f, 0.200000f, 4.094307f, 0.200000f},
+    {2.080841f, 0.200000f, 6.716384f, 0.200000f},
+    {2.287131f, 0.200000f, 8.583242f, 0.200000f},
+    {4.329136f, 0.200000f, -7.497218f, 0.200000f},
+    {4.502115f, 0.200000f, -5.941060f, 0.200000f},
+    {4.750631f, 0.200000f, -3.836759f, 0.200000f},
+    {4.082084f, 0.200000f, -1.180746f, 0.200000f},
+    {4.429173f, 0.200000f, 2.069721f, 0.200000f},
+    {4.277152f, 0.200000f, 4.297482f, 0.200000f},
+    {4.012743f, 0.200000f, 6.225072f, 0.200000f},
+    {4.047066f, 0.200000f, 8.419360f, 0.200000f},
+    {6.441846f, 0.200000f, -7.700798f, 0.200000f},
+    {6.047810f, 0.200000f, -5.519369f, 0.200000f},
+    {6.779211f, 0.200000f, -3.740542f, 0.200000f},
+    {6.430776f, 0.200000f, -1.332107f, 0.200000f},
+    {6.476387f, 0.200000f, 0.329973f, 0.200000f},
+    {6.568686f, 0.200000f, 2.116949f, 0.200000f},
+    {6.371189f, 0.200000f, 4.609841f, 0.200000f},
+    {6.011877f, 0.200000f, 6.569579f, 0.200000f},
+    {6.096087f, 0.200000f, 8.892333f, 0.200000f},
+    {8.185763f, 0.200000f, -7.191109f, 0.200000f},
+    {8.411960f, 0.200000f, -5.285309f, 0.200000f},
+    {8.047109f, 0.200000f, -3.427552f, 0.200000f},
+    {8.119639f, 0.200000f, -1.652587f, 0.200000f},
+    {8.818120f, 0.200000f, 0.401292f, 0.200000f},
+    {8.754155f, 0.200000f, 2.152549f, 0.200000f},
+    {8.595298f, 0.200000f, 4.802001f, 0.200000f},
+    {8.036216f, 0.200000f, 6.739752f, 0.200000f},
+    {8.256561f, 0.200000f, 8.129115f, 0.200000f},
+    {0.000000f, 2.000000f, 0.000000f, 1.000000f},
+    {-4.000000f, 2.000000f, 0.000000f, 1.000000f},
+    {4.000000f, 2.000000f, 0.000000f, 1.000000f}
+}};
+
+AnalyticPrimitive MakeSphere(glm::vec3 center, float radius, size_t material_id) {
+    return AnalyticPrimitive{center, radius, center, PRIMITIVE_SPHERE, static_cast<GLuint>(material_id), {}};
+}
+
+AnalyticPrimitive MakeCylinder(glm::vec3 start_position, glm::vec3 end_position, float radius, size_t material_id) {
+    return AnalyticPrimitive{start_position, radius, end_position, PRIMITIVE_CYLINDER, static_cast<GLuint>(material_id), {}};
+}
+
+std::vector<Material> GetSceneMaterials() {
+    return {
+        Material{glm::vec3{0.3f, 0.5f, 0.4f}, MATERIAL_METAL, 0.1f, 1.5f, {}},
+        Material{glm::vec3{1.0f, 0.71f, 0.29f}, MATERIAL_METAL, 0.02f, 1.5f, {}},
+        Material{glm::vec3{0.0f, 1.0f, 0.0f}, MATERIAL_LAMBERTIAN, 0.3f, 1.5f, {}},
+        Material{glm::vec3{1.0f, 1.0f, 0.0f}, MATERIAL_METAL, 0.9f, 1.5f, {}},
+        Material{glm::vec3{1.0f, 0.0f, 0.0f}, MATERIAL_METAL, 0.01f, 1.5f, {}},
+        Material{glm::vec3{0.0f, 1.0f, 1.0f}, MATERIAL_DIELECTRIC, 0.3f, 1.8f, {}},
+        Material{glm::vec3{0.0f, 1.0f, 1.0f}, MATERIAL_DIELECTRIC, 0.0f, 1.5f, {}}
+    };
+}
+
+std::vector<AnalyticPrimitive> GetScenePrimitives() {
+    std::vector<AnalyticPrimitive> primitives{};
+    size_t material_count = GetSceneMaterials().size();
+
+    // the spheres cycle through the materials
+    for (size_t i = 0; i < SCENE_SPHERES.size(); i++) {
+        const std::array<float, 4>& sphere = SCENE_SPHERES[i];
+        primitives.push_back(MakeSphere(glm::vec3{sphere[0], sphere[1], sphere[2]}, sphere[3], i % material_count));
+    }
+    primitives.push_back(MakeCylinder(glm::vec3{2.1f, 0.1f, -2.0f}, glm::vec3{1.9f, 0.5f, -1.9f}, 0.08f, 0));
+
+    return primitives;
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <string>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 
 #include <SDL2/SDL.h>
 
@@ -31,34 +33,83 @@ void CompileShaderFromSource(const GLuint loadedShader, std::string_view shaderC
         SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, (result) ? SDL_LOG_PRIORITY_WARN : SDL_LOG_PRIORITY_ERROR, "[glLinkProgram] Shader compile error: %s", ErrorMessage.data());
     }
 }
-void LoadShader(const GLuint loadedShader, const std::filesystem::path& _fileName) {
-    // ha nem sikerult hibauzenet es -1 visszaadasa
-    if (loadedShader == 0) {
-        SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "Shader needs to be inited before loading %s !", _fileName.c_str());
-        return;
-    }
-
-    // shaderkod betoltese _fileName fajlbol
-    std::string shaderCode = "";
-
+bool ReadShaderSource(const std::filesystem::path& _fileName, std::string& shaderCode, size_t include_depth) {
     // _fileName megnyitasa
     std::ifstream shaderStream(_fileName);
     if (!shaderStream.is_open()) {
         SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "Error while loading shader %s!", _fileName.c_str());
-        return;
+        return false;
     }
 
     // file tartalmanak betoltese a shaderCode string-be
+    // the #include "file" lines are replaced by the file (relative to the including one), glsl doesn't have includes on its own
     std::string line = "";
     while (std::getline(shaderStream, line)) {
-        shaderCode += line + "\n";
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (line.size() > 11 && line.rfind("#include \"", 0) == 0 && line.back() == '"') {
+            if (include_depth == 16) {
+                SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "Too deeply nested includes in shader %s!", _fileName.c_str());
+                return false;
+            }
+
+            std::filesystem::path include_filename = _fileName.parent_path() / line.substr(10, line.size() - 11);
+            if (!ReadShaderSource(include_filename, shaderCode, include_depth + 1)) {
+                return false;
+            }
+        } else {
+            shaderCode += line + "\n";
+        }
     }
 
     shaderStream.close();
+    return true;
+}
+
+void LoadShader(const GLuint loadedShader, const std::filesystem::path& _fileName, const std::vector<std::string>& defines = {}) {
+    // ha nem sikerult hibauzenet es -1 visszaadasa
+    if (loadedShader == 0) {
+        SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "Shader needs to be inited before loading %s !", _fileName.c_str());
+        return;
+    }
+
+    // shaderkod betoltese _fileName fajlbol
+    std::string shaderCode = "";
+    if (!ReadShaderSource(_fileName, shaderCode, 0)) {
+        return;
+    }
+
+    // the defines have to come after the #version line
+    if (!defines.empty()) {
+        std::string define_lines = "";
+        for (const std::string& define : defines) {
+            define_lines += "#define " + define + "\n";
+        }
+        shaderCode.insert(shaderCode.find('\n') + 1, define_lines);
+    }
 
     CompileShaderFromSource(loadedShader, shaderCode);
 }
 
+void LinkProgram(const GLuint program_id) {
+    // illesszük össze a shadereket (kimenő-bemenő változók összerendelése stb.)
+    glLinkProgram(program_id);
+
+    // linkeles ellenorzese
+    GLint infoLogLength = 0;
+    GLint result = 0;
+
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &infoLogLength);
+    if (GL_FALSE == result || infoLogLength != 0) {
+        std::string ErrorMessage(infoLogLength, '\0');
+        glGetProgramInfoLog(program_id, infoLogLength, nullptr, ErrorMessage.data());
+        SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, (result) ? SDL_LOG_PRIORITY_WARN : SDL_LOG_PRIORITY_ERROR, "[glLinkProgram] Shader linking error: %s", ErrorMessage.data());
+    }
+}
+
 Shader::Shader(const std::filesystem::path& vs_filename, const std::filesystem::path& fs_filename) {
     m_program_id = glCreateProgram();
 
@@ -80,26 +131,36 @@ Shader::Shader(const std::filesystem::path& vs_filename, const std::filesystem::
     glAttachShader(m_program_id, vs_id);
     glAttachShader(m_program_id, fs_id);
 
-    // illesszük össze a shadereket (kimenő-bemenő változók összerendelése stb.)
-    glLinkProgram(m_program_id);
-
-    // linkeles ellenorzese
-    GLint infoLogLength = 0;
-    GLint result = 0;
-
-    glGetProgramiv(m_program_id, GL_LINK_STATUS, &result);
-    glGetProgramiv(m_program_id, GL_INFO_LOG_LENGTH, &infoLogLength);
-    if (GL_FALSE == result || infoLogLength != 0) {
-        std::string ErrorMessage(infoLogLength, '\0');
-        glGetProgramInfoLog(m_program_id, infoLogLength, nullptr, ErrorMessage.data());
-        SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, (result) ? SDL_LOG_PRIORITY_WARN : SDL_LOG_PRIORITY_ERROR, "[glLinkProgram] Shader linking error: %s", ErrorMessage.data());
-    }
+    LinkProgram(m_program_id);
+    CacheUniformLocations();
 
     // mar nincs ezekre szukseg
     glDeleteShader(vs_id);
     glDeleteShader(fs_id);
 }
 
+Shader::Shader(const std::filesystem::path& cs_filename, const std::vector<std::string>& defines) {
+    m_program_id = glCreateProgram();
+
+    if (m_program_id == 0) {
+        return;
+    }
+
+    GLuint cs_id = glCreateShader(GL_COMPUTE_SHADER);
+
+    if (cs_id == 0) {
+        SDL_SetError("Error while initing shaders (glCreateShader)!");
+    }
+
+    LoadShader(cs_id, cs_filename, defines);
+
+    glAttachShader(m_program_id, cs_id);
+    LinkProgram(m_program_id);
+    CacheUniformLocations();
+
+    glDeleteShader(cs_id);
+}
+
 Shader::~Shader() {
     glDeleteProgram(m_program_id);
 }
@@ -109,9 +170,42 @@ void Shader::Use() {
 }
 
 GLint Shader::ul(const GLchar* name) {
-    return glGetUniformLocation(m_program_id, name);
+    auto it = std::lower_bound(m_uniform_locations.begin(), m_uniform_locations.end(), name, [](const std::pair<std::string, GLint>& uniform, const GLchar* name) {
+        return std::strcmp(uniform.first.c_str(), name) < 0;
+    });
+    return (it != m_uniform_locations.end() && it->first == name) ? it->second : -1;
 }
 
 GLuint Shader::GetProgramID() {
     return m_program_id;
+}
+
+void Shader::CacheUniformLocations() {
+    GLint uniform_count = 0;
+    GLint max_name_length = 0;
+    glGetProgramiv(m_program_id, GL_ACTIVE_UNIFORMS, &uniform_count);
+    glGetProgramiv(m_program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+    std::string name(static_cast<size_t>(max_name_length), '\0');
+    for (GLint i = 0; i < uniform_count; i++) {
+        GLsizei name_length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(m_program_id, static_cast<GLuint>(i), max_name_length, &name_length, &size, &type, name.data());
+
+        // the members of uniform blocks don't have a location
+        GLint location = glGetUniformLocation(m_program_id, name.c_str());
+        if (location == -1) {
+            continue;
+        }
+
+        std::string uniform_name = name.substr(0, static_cast<size_t>(name_length));
+        // arrays are listed as "name[0]" but they are usually set by their name
+        if (uniform_name.size() > 3 && uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0) {
+            m_uniform_locations.emplace_back(uniform_name.substr(0, uniform_name.size() - 3), location);
+        }
+        m_uniform_locations.emplace_back(std::move(uniform_name), location);
+    }
+
+    std::sort(m_uniform_locations.begin(), m_uniform_locations.end());
 }
\ No newline at end of file
@@ -5,9 +5,31 @@
 #include <ranges>
 #include <string>
 
+void SetCubeMapSampling(GLuint texture_id) {
+    glTextureParameteri(texture_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(texture_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture_id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
 Skybox::Skybox() {
     glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_texture_id);
 
+    const GLubyte black[4] = {0, 0, 0, 255};
+    glTextureStorage2D(m_texture_id, 1, GL_RGBA8, 1, 1);
+    for (GLint index = 0; index < 6; index++) {
+        glTextureSubImage3D(m_texture_id, 0, 0, 0, index, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, black);
+    }
+
+    SetCubeMapSampling(m_texture_id);
+}
+
+Skybox::~Skybox() {
+    glDeleteTextures(1, &m_texture_id);
+}
+
+std::vector<SDL_Surface*> Skybox::LoadFaces() {
     std::vector<std::string> filenames = {
         "assets/skybox_xpos.png", 
         "assets/skybox_xneg.png", 
@@ -20,9 +42,6 @@ Skybox::Skybox() {
 
     std::vector<SDL_Surface*> surfaces{};
 
-    int max_width = 0;
-    int max_height = 0;
-
     for (const std::string& filename : filenames) {
         SDL_Surface* loaded_surface = IMG_Load(filename.c_str());
 
@@ -34,31 +53,44 @@ Skybox::Skybox() {
         SDL_FreeSurface(loaded_surface);
         if (formatted_surface == nullptr) {
             SDL_LogMessage(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR, "[TextureFromFile] Error while processing texture");
-            return;
+            for (SDL_Surface* surface : surfaces) {
+                SDL_FreeSurface(surface);
+            }
+            return {};
         }
 
         surfaces.push_back(formatted_surface);
-        max_width = std::max(max_width, formatted_surface->w);
-        max_height = std::max(max_height, formatted_surface->h);
     }
 
+    return surfaces;
+}
 
-    glTextureStorage2D(m_texture_id, 1, GL_RGBA8, max_width, max_height);
-
-    for (size_t index = 0; index < surfaces.size(); index++) {
-        glTextureSubImage3D(m_texture_id, 0, 0, 0, index, surfaces[index]->w, surfaces[index]->h, 1, GL_RGBA, GL_UNSIGNED_BYTE, surfaces[index]->pixels);
-        SDL_FreeSurface(surfaces[index]);
+void Skybox::Upload(std::vector<SDL_Surface*>& faces) {
+    if (faces.empty()) {
+        return;
     }
 
-    glTextureParameteri(m_texture_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTextureParameteri(m_texture_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameteri(m_texture_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_texture_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_texture_id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-}
+    int max_width = 0;
+    int max_height = 0;
 
-Skybox::~Skybox() {
+    for (const SDL_Surface* surface : faces) {
+        max_width = std::max(max_width, surface->w);
+        max_height = std::max(max_height, surface->h);
+    }
+
+    // the storage is immutable, so the placeholder is replaced by a new texture
     glDeleteTextures(1, &m_texture_id);
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_texture_id);
+
+    glTextureStorage2D(m_texture_id, 1, GL_RGBA8, max_width, max_height);
+
+    for (size_t index = 0; index < faces.size(); index++) {
+        glTextureSubImage3D(m_texture_id, 0, 0, 0, index, faces[index]->w, faces[index]->h, 1, GL_RGBA, GL_UNSIGNED_BYTE, faces[index]->pixels);
+        SDL_FreeSurface(faces[index]);
+    }
+    faces.clear();
+
+    SetCubeMapSampling(m_texture_id);
 }
 
 GLuint Skybox::GetTextureID() {
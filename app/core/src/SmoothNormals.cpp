@@ -0,0 +1,43 @@
+#include "SmoothNormals.hpp"
+
+#include "ThreadPool.hpp"
+
+constexpr size_t MIN_PARALLEL_NORMAL_COUNT = 1 << 14;
+
+glm::vec3 GetTriangleNormal(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+    glm::vec3 normal = glm::cross(v1 - v0, v2 - v0);
+    return (glm::dot(normal, normal) > 0.0f) ? glm::normalize(normal) : glm::vec3{0.0f};
+}
+
+glm::vec3 FinishSmoothNormal(const glm::vec3& normal_sum) {
+    return (glm::dot(normal_sum, normal_sum) > 0.0f) ? glm::normalize(normal_sum) : SMOOTH_NORMAL_START;
+}
+
+std::vector<glm::vec3> ComputeSmoothNormals(size_t position_count, const std::vector<unsigned int>& triangle_positions, const std::vector<glm::vec3>& triangle_normals) {
+    std::vector<unsigned int> adjacency_offsets(position_count + 1, 0);
+    for (unsigned int position : triangle_positions) {
+        adjacency_offsets[position + 1]++;
+    }
+    for (size_t i = 1; i < adjacency_offsets.size(); i++) {
+        adjacency_offsets[i] += adjacency_offsets[i - 1];
+    }
+
+    std::vector<unsigned int> adjacent_triangles(triangle_positions.size());
+    std::vector<unsigned int> fill_offsets(adjacency_offsets.cbegin(), adjacency_offsets.cend() - 1);
+    for (size_t i = 0; i < triangle_positions.size(); i++) {
+        adjacent_triangles[fill_offsets[triangle_positions[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    // each position is reduced by a single thread, so no atomics are needed
+    std::vector<glm::vec3> normals(position_count);
+    ThreadPool::Shared().ParallelFor(position_count, MIN_PARALLEL_NORMAL_COUNT, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+            glm::vec3 normal_sum = SMOOTH_NORMAL_START;
+            for (unsigned int j = adjacency_offsets[p]; j < adjacency_offsets[p + 1]; j++) {
+                normal_sum += triangle_normals[adjacent_triangles[j]];
+            }
+            normals[p] = FinishSmoothNormal(normal_sum);
+        }
+    });
+    return normals;
+}
\ No newline at end of file
@@ -33,3 +33,8 @@ GLuint Texture2D::GetTextureID() {
 void Texture2D::Bind(GLuint unit, GLenum access) {
     glBindImageTexture(unit, m_texture_id, 0, GL_FALSE, 0, access, m_format);
 }
+
+
+void Texture2D::BindTexture(GLuint unit) {
+    glBindTextureUnit(unit, m_texture_id);
+}
\ No newline at end of file
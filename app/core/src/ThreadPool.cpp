@@ -0,0 +1,54 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t thread_count) : m_stopping{false} {
+    for (size_t i = 0; i < thread_count; i++) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool shared_pool{std::max(std::thread::hardware_concurrency(), 2u) - 1};
+    return shared_pool;
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return m_workers.size();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "WavefrontRayTracer.hpp"
+
+// has to match wavefront.glsl
+constexpr GLuint WAVEFRONT_GROUP_SIZE = 64;
+constexpr GLuint GENERATE_TILE_SIZE = 8;
+constexpr GLsizeiptr QUEUE_HEADER_SIZE = 4 * sizeof(GLuint);
+constexpr GLsizeiptr WAVEFRONT_RAY_SIZE = 16 * sizeof(GLuint);
+constexpr GLsizeiptr WAVEFRONT_HIT_SIZE = 12 * sizeof(GLuint);
+
+// the indirect dispatch arguments of an empty queue (the entry count is the last one)
+constexpr GLuint EMPTY_QUEUE_HEADER[4] = {0, 1, 1, 0};
+
+// every pixel has at most one ray in flight, so a queue never has more entries than the pixels
+GLsizeiptr GetRayQueueSize(GLsizei width, GLsizei height) {
+    return QUEUE_HEADER_SIZE + static_cast<GLsizeiptr>(width) * height * WAVEFRONT_RAY_SIZE;
+}
+
+GLsizeiptr GetHitQueueSize(GLsizei width, GLsizei height) {
+    return QUEUE_HEADER_SIZE + static_cast<GLsizeiptr>(width) * height * WAVEFRONT_HIT_SIZE;
+}
+
+GLsizeiptr GetMissQueueSize(GLsizei width, GLsizei height) {
+    return QUEUE_HEADER_SIZE + static_cast<GLsizeiptr>(width) * height * static_cast<GLsizeiptr>(sizeof(GLuint));
+}
+
+WavefrontRayTracer::WavefrontRayTracer(GLsizei width, GLsizei height) :
+    m_width{width},
+    m_height{height},
+    m_generate_shader{"assets/wavefront_generate.comp"},
+    m_extend_shader{"assets/wavefront_extend.comp"},
+    m_shade_shader{"assets/wavefront_shade.comp"},
+    m_miss_shader{"assets/wavefront_miss.comp"},
+    m_ray_queues{
+        Buffer{GetRayQueueSize(width, height), nullptr, GL_DYNAMIC_STORAGE_BIT}, 
+        Buffer{GetRayQueueSize(width, height), nullptr, GL_DYNAMIC_STORAGE_BIT}
+    },
+    m_hit_queue{GetHitQueueSize(width, height), nullptr, GL_DYNAMIC_STORAGE_BIT},
+    m_miss_queue{GetMissQueueSize(width, height), nullptr, GL_DYNAMIC_STORAGE_BIT}
+{
+}
+
+WavefrontRayTracer::~WavefrontRayTracer() {
+    glDeleteQueries(static_cast<GLsizei>(m_timestamp_queries.size()), m_timestamp_queries.data());
+}
+
+void WavefrontRayTracer::Resize(GLsizei width, GLsizei height) {
+    m_width = width;
+    m_height = height;
+
+    m_ray_queues[0].Resize(GetRayQueueSize(width, height), nullptr);
+    m_ray_queues[1].Resize(GetRayQueueSize(width, height), nullptr);
+    m_hit_queue.Resize(GetHitQueueSize(width, height), nullptr);
+    m_miss_queue.Resize(GetMissQueueSize(width, height), nullptr);
+}
+
+void WavefrontRayTracer::Trace(GLuint max_recursion_limit, GLuint samples_per_pixel) {
+    ReadStageTimes();
+    m_used_query_count = 0;
+
+    for (GLuint sample_index = 0; sample_index < samples_per_pixel; sample_index++) {
+        // the generate pass appends the rays of the pixels that aren't converged
+        // (the previous sample has to be done with the queue, and with the accumulation of its pixels)
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        m_ray_queues[0].Update(0, QUEUE_HEADER_SIZE, EMPTY_QUEUE_HEADER);
+
+        m_ray_queues[0].Bind(5);
+        m_generate_shader.Use();
+        glUniform1ui(m_generate_shader.ul("sample_index"), sample_index);
+        BeginStageTimer(GENERATE);
+        glDispatchCompute((static_cast<GLuint>(m_width) + GENERATE_TILE_SIZE - 1) / GENERATE_TILE_SIZE, (static_cast<GLuint>(m_height) + GENERATE_TILE_SIZE - 1) / GENERATE_TILE_SIZE, 1);
+        EndStageTimer();
+
+        // the rays of one bounce are all extended before any of them is shaded, the queues are emptied before they are appended to
+        for (GLuint bounce = 0; bounce < max_recursion_limit; bounce++) {
+            Buffer& incoming_queue = m_ray_queues[bounce % 2];
+            Buffer& outgoing_queue = m_ray_queues[(bounce + 1) % 2];
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            outgoing_queue.Update(0, QUEUE_HEADER_SIZE, EMPTY_QUEUE_HEADER);
+            m_hit_queue.Update(0, QUEUE_HEADER_SIZE, EMPTY_QUEUE_HEADER);
+            m_miss_queue.Update(0, QUEUE_HEADER_SIZE, EMPTY_QUEUE_HEADER);
+
+            incoming_queue.Bind(4);
+            outgoing_queue.Bind(5);
+            m_hit_queue.Bind(6);
+            m_miss_queue.Bind(7);
+
+            DispatchIndirect(EXTEND, m_extend_shader, incoming_queue);
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            // the two only write different pixels and different queues, so there is no barrier between them
+            DispatchIndirect(SHADE, m_shade_shader, m_hit_queue);
+            DispatchIndirect(MISS, m_miss_shader, m_miss_queue);
+        }
+    }
+
+    // the accumulation and the depth image are read by the resolve pass
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+const std::array<float, WavefrontRayTracer::STAGE_COUNT>& WavefrontRayTracer::GetStageMilliseconds() {
+    return m_stage_milliseconds;
+}
+
+// the size of the dispatch is read from the header of the queue the pass consumes, it was written by the previous pass on the gpu
+void WavefrontRayTracer::DispatchIndirect(Stage stage, Shader& shader, Buffer& queue) {
+    shader.Use();
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, queue.GetBufferID());
+
+    BeginStageTimer(stage);
+    glDispatchComputeIndirect(0);
+    EndStageTimer();
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+void WavefrontRayTracer::BeginStageTimer(Stage stage) {
+    if (m_used_query_count + 2 > m_timestamp_queries.size()) {
+        m_timestamp_queries.resize(m_used_query_count + 2);
+        glGenQueries(2, &m_timestamp_queries[m_used_query_count]);
+    }
+    m_query_stages.resize(m_used_query_count / 2 + 1);
+    m_query_stages[m_used_query_count / 2] = stage;
+
+    glQueryCounter(m_timestamp_queries[m_used_query_count], GL_TIMESTAMP);
+}
+
+void WavefrontRayTracer::EndStageTimer() {
+    glQueryCounter(m_timestamp_queries[m_used_query_count + 1], GL_TIMESTAMP);
+    m_used_query_count += 2;
+}
+
+// the results of the previous frame are only read when all of them are there, the rendering never waits for them
+// (if they aren't ready the queries are reused and that frame isn't measured)
+void WavefrontRayTracer::ReadStageTimes() {
+    if (m_used_query_count == 0) {
+        return;
+    }
+
+    GLint is_available = GL_FALSE;
+    glGetQueryObjectiv(m_timestamp_queries[m_used_query_count - 1], GL_QUERY_RESULT_AVAILABLE, &is_available);
+    if (is_available == GL_FALSE) {
+        return;
+    }
+
+    m_stage_milliseconds.fill(0.0f);
+    for (size_t i = 0; i < m_used_query_count; i += 2) {
+        GLuint64 start_time;
+        GLuint64 end_time;
+        glGetQueryObjectui64v(m_timestamp_queries[i], GL_QUERY_RESULT, &start_time);
+        glGetQueryObjectui64v(m_timestamp_queries[i + 1], GL_QUERY_RESULT, &end_time);
+        m_stage_milliseconds[m_query_stages[i / 2]] += static_cast<float>(end_time - start_time) / 1000000.0f;
+    }
+}
\ No newline at end of file
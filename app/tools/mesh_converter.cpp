@@ -0,0 +1,44 @@
+#include <SDL2/SDL.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+
+// converts a mesh that Mesh can load (obj or ply) into the binary format, which can be loaded without any parsing
+// the levels of detail are generated here as well, so the simplification doesn't slow down loading
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " input.obj|input.ply output" << MESH_FILE_EXTENSION << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path input_filename{argv[1]};
+    std::filesystem::path output_filename{argv[2]};
+
+    auto start = std::chrono::steady_clock::now();
+    Mesh mesh{input_filename, 0, glm::mat4{1.0f}};
+    auto loaded = std::chrono::steady_clock::now();
+    mesh.GenerateLods();
+    auto simplified = std::chrono::steady_clock::now();
+
+    if (!WriteMeshFile(output_filename, mesh.m_vertecies, mesh.m_normals, mesh.m_triangles, mesh.m_lod_triangles, 0)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[mesh_converter] error: couldn't write %s", output_filename.string().c_str());
+        return 1;
+    }
+    auto written = std::chrono::steady_clock::now();
+
+    std::cout << input_filename.string() << ": " << mesh.m_vertecies.size() << " vertecies, " << mesh.m_triangles.size() << " triangles" << std::endl;
+    std::cout << "loaded in " << std::chrono::duration<double, std::milli>(loaded - start).count() << " ms, ";
+    std::cout << "simplified in " << std::chrono::duration<double, std::milli>(simplified - loaded).count() << " ms, ";
+    std::cout << "written in " << std::chrono::duration<double, std::milli>(written - simplified).count() << " ms" << std::endl;
+    for (size_t i = 0; i < mesh.m_lod_triangles.size(); i++) {
+        std::cout << "lod " << (i + 1) << ": " << mesh.m_lod_triangles[i].size() << " triangles" << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <SDL2/SDL.h>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "ObjParser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+
+
+// parse throughput of ObjParser compared to tinyobjloader, which Mesh used to load the obj files with
+double MeasureBestMilliseconds(size_t iterations, const std::function<void()>& parse) {
+    double best_milliseconds = 0.0;
+    for (size_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        parse();
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best_milliseconds = (i == 0) ? milliseconds : std::min(best_milliseconds, milliseconds);
+    }
+    return best_milliseconds;
+}
+
+void PrintResult(const std::string& name, double milliseconds, uintmax_t file_size) {
+    double megabytes_per_second = (static_cast<double>(file_size) / (1024.0 * 1024.0)) / (milliseconds / 1000.0);
+    std::cout << name << ": " << milliseconds << " ms, " << megabytes_per_second << " MB/s" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " input.obj [iterations]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path filename{argv[1]};
+    size_t iterations = (argc == 3) ? std::stoul(argv[2]) : 5;
+
+    std::error_code error;
+    uintmax_t file_size = std::filesystem::file_size(filename, error);
+    if (error) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[obj_benchmark] error: couldn't open %s", filename.string().c_str());
+        return 1;
+    }
+
+    std::cout << filename.string() << ": " << file_size << " bytes, best of " << iterations << " runs" << std::endl;
+
+    double tinyobj_milliseconds = MeasureBestMilliseconds(iterations, [&filename]() {
+        tinyobj::ObjReader reader;
+        if (!reader.ParseFromFile(filename.string())) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[obj_benchmark] TinyObjReader loading error: %s", reader.Error().c_str());
+        }
+    });
+    PrintResult("tinyobjloader", tinyobj_milliseconds, file_size);
+
+    double serial_milliseconds = MeasureBestMilliseconds(iterations, [&filename]() {
+        ObjParser::parse(filename, false);
+    });
+    PrintResult("ObjParser serial", serial_milliseconds, file_size);
+
+    double parallel_milliseconds = MeasureBestMilliseconds(iterations, [&filename]() {
+        ObjParser::parse(filename, true);
+    });
+    PrintResult("ObjParser parallel", parallel_milliseconds, file_size);
+
+    return 0;
+}
\ No newline at end of file